@@ -4,23 +4,31 @@
 in vec2 UV;
 in vec3 position_worldSpace;
 in vec3 eyeDirection_cameraSpace;
-in vec3 lightDirection_cameraSpace;
 in vec3 normal_cameraSpace;
 
 // Output data
-out vec4 color;
+// With weighted blended transparency these are the accumulation and weight targets, see oitReference.hpp
+layout(location = 0) out vec4 color;
+layout(location = 1) out vec4 weightSum;
 
 // Values that stay constant for the whole mesh
 uniform sampler2D	textureSampler;
-uniform vec3		lightColor;
-uniform float		lightStrength;
-uniform vec3		lightPosition_worldSpace;
 uniform float		alpha;
+uniform bool		weightedOIT;
+
+// Clustered lights, see LightClusterGrid
+// lightData holds two texels per light: camera space position + radius, color * intensity + intensity
+// clusterData holds the offset and count of each cluster's list in lightIndices
+uniform samplerBuffer	lightData;
+uniform usamplerBuffer	clusterData;
+uniform usamplerBuffer	lightIndices;
+uniform ivec3			clusterDims;
+uniform vec2			clusterDepthScaleBias;	// slice = log(depth) * scale + bias
+uniform vec2			screenSize;
 
 void main()
 {
 	vec3 n = normalize(normal_cameraSpace);
-	vec3 l = normalize(lightDirection_cameraSpace);
 	vec3 e = normalize(eyeDirection_cameraSpace);
 
 	vec3 materialDiffuseColor =		texture(textureSampler, UV).rgb;
@@ -28,23 +36,55 @@ void main()
 	vec3 materialSpecularColor =	vec3(0.3,0.3,0.3);
 
 	//--------------------------------------------
-	// Diffuse Reflection Calcs
+	// Cluster Lookup
 	//--------------------------------------------
 
-	// Cosine of the angle between the normal and the light direction, clamped above 0
-	float cosTheta = clamp( dot( n,l ), 0,1 );
+	// Depth along the view direction, the camera looks down -z
+	float depth = eyeDirection_cameraSpace.z;
+	int slice = clamp(int(log(depth) * clusterDepthScaleBias.x + clusterDepthScaleBias.y), 0, clusterDims.z - 1);
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / screenSize * vec2(clusterDims.xy)), ivec2(0), clusterDims.xy - 1);
 
-	// Distance to the light
-	float distance = length( lightPosition_worldSpace - position_worldSpace );
+	int cluster = (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+	uvec2 lightRange = texelFetch(clusterData, cluster).xy;
 
-	//--------------------------------------------
-	// Specular Reflection Calcs
-	//--------------------------------------------
+	vec3 diffuseLight = vec3(0);
+	vec3 specularLight = vec3(0);
+
+	for (uint i = 0u; i < lightRange.y; ++i)
+	{
+		int lightIndex = int(texelFetch(lightIndices, int(lightRange.x + i)).r);
+		vec4 lightPositionRadius = texelFetch(lightData, 2 * lightIndex);
+		vec3 lightColorIntensity = texelFetch(lightData, 2 * lightIndex + 1).rgb;
+
+		// Vector from fragment to light
+		vec3 lightDirection_cameraSpace = lightPositionRadius.xyz + eyeDirection_cameraSpace;
+		float distance = length(lightDirection_cameraSpace);
+		vec3 l = lightDirection_cameraSpace / distance;
+
+		//--------------------------------------------
+		// Diffuse Reflection Calcs
+		//--------------------------------------------
+
+		// Cosine of the angle between the normal and the light direction, clamped above 0
+		float cosTheta = clamp( dot( n,l ), 0,1 );
 
-	vec3 r = reflect(-l, n);
+		//--------------------------------------------
+		// Specular Reflection Calcs
+		//--------------------------------------------
 
-	// Cosine of the angle between direction the camera faces and the direction of reflection
-	float cosAlpha = clamp( dot( e,r ), 0,1 );
+		vec3 r = reflect(-l, n);
+
+		// Cosine of the angle between direction the camera faces and the direction of reflection
+		float cosAlpha = clamp( dot( e,r ), 0,1 );
+
+		// Light intensity is inversely proprtional to square of distance
+		// Windowed so it reaches zero at the light's radius, which is what lets it be clustered
+		float window = clamp(1.0 - pow(distance / lightPositionRadius.w, 4.0), 0, 1);
+		float attenuation = window * window / (distance * distance);
+
+		diffuseLight += lightColorIntensity * cosTheta * attenuation;
+		specularLight += lightColorIntensity * pow(cosAlpha,5) * attenuation;
+	}
 
 	//--------------------------------------------
 	// Final Color Calc
@@ -56,11 +96,20 @@ void main()
 	materialAmbientColor +
 	
 	// Diffuse lighting from object color
-	// Light intensity is inversely proprtional to square of distance
-	materialDiffuseColor * lightColor * lightStrength * cosTheta / (distance * distance) +
+	materialDiffuseColor * diffuseLight +
 
 	// Specilar lighting from reflection intensity
-	materialSpecularColor * lightColor * lightStrength * pow(cosAlpha,5) / (distance*distance);
+	materialSpecularColor * specularLight;
 
 	color.a = alpha;
-}
\ No newline at end of file
+
+	if (weightedOIT)
+	{
+		// Depth weight, keeps near fragments dominant while staying within half float range
+		float weight = alpha * clamp(10.0 / (1e-5 + pow(depth / 5.0, 2.0) + pow(depth / 200.0, 6.0)), 1e-2, 3e3);
+
+		// rgb is summed, a is blended to the product of (1 - alpha)
+		color = vec4(color.rgb * alpha * weight, alpha);
+		weightSum = vec4(alpha * weight);
+	}
+}
@@ -11,14 +11,15 @@ layout(location = 2) in vec3 vertexNormal_modelSpace;
 out vec2 UV;
 out vec3 position_worldSpace;
 out vec3 eyeDirection_cameraSpace;
-out vec3 lightDirection_cameraSpace;
 out vec3 normal_cameraSpace;
 
+// Same depths as depthOnlyVertexShader.glsl, the shading pass after a depth prepass relies on it
+invariant gl_Position;
+
 // Stays constant for entire mesh
 uniform mat4 MVP;
 uniform mat4 M;
 uniform mat4 V;
-uniform vec3 lightPosition_worldSpace;
 
 void main()
 {
@@ -29,13 +30,10 @@ void main()
 	position_worldSpace = (M * vec4(vertexPosition_modelSpace, 1)).xyz;
 
 	// Vector from vertex to camera center, with camera center at origin in camera space
+	// Lights are uploaded in camera space, so the fragment shader gets light directions from this too
 	vec3 vertexPosition_cameraSpace = ( V * M * vec4(vertexPosition_modelSpace,1)).xyz;
 	eyeDirection_cameraSpace = vec3(0,0,0) - vertexPosition_cameraSpace;
 
-	// Vector from vertex to light. Lights have identity M matrix
-	vec3 lightPosition_cameraSpace = ( V * vec4(lightPosition_worldSpace,1)).xyz;
-	lightDirection_cameraSpace = lightPosition_cameraSpace + eyeDirection_cameraSpace;
-
 	// Vertex Normal in camera space.
 	// Only correct if Model Matrix does not scale the model ! Use its inverse transpose if not.
 	normal_cameraSpace = (V * M * vec4(vertexNormal_modelSpace, 0)).xyz;
@@ -0,0 +1,6 @@
+#version 330 core
+
+// Depth prepass, color writes are masked off and only depth is kept
+void main()
+{
+}
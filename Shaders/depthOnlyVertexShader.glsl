@@ -0,0 +1,14 @@
+#version 330 core
+
+// Depth prepass, only the position is needed
+layout(location = 0) in vec3 vertexPosition_modelSpace;
+
+// Must match basicVertexShader.glsl exactly so the shading pass lands on the same depths
+invariant gl_Position;
+
+uniform mat4 MVP;
+
+void main()
+{
+	gl_Position = MVP * vec4(vertexPosition_modelSpace, 1);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Full screen triangle, no vertex buffer needed
+out vec2 UV;
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+	UV = position;
+	gl_Position = vec4(position * 2.0 - 1.0, 0, 1);
+}
@@ -0,0 +1,38 @@
+#version 330 core
+
+// Builds one level of the hierarchical Z pyramid, each texel keeps the farthest depth below it
+in vec2 UV;
+
+layout(location = 0) out float maxDepth;
+
+// The depth buffer for the first level, the previous pyramid level after that
+// Only the source level is in the sampler's base/max level range, so lod 0 reads it
+uniform sampler2D	sourceSampler;
+uniform ivec2		sourceSize;
+
+float fetchDepth(ivec2 texel)
+{
+	return texelFetch(sourceSampler, min(texel, sourceSize - 1), 0).r;
+}
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+
+	maxDepth = max(
+		max(fetchDepth(texel), fetchDepth(texel + ivec2(1, 0))),
+		max(fetchDepth(texel + ivec2(0, 1)), fetchDepth(texel + ivec2(1, 1))));
+
+	// Odd sized sources leave a row or column over, the last texel of this level covers it too
+	bool extraColumn = (sourceSize.x & 1) != 0 && texel.x + 3 == sourceSize.x;
+	bool extraRow = (sourceSize.y & 1) != 0 && texel.y + 3 == sourceSize.y;
+
+	if (extraColumn)
+		maxDepth = max(maxDepth, max(fetchDepth(texel + ivec2(2, 0)), fetchDepth(texel + ivec2(2, 1))));
+
+	if (extraRow)
+		maxDepth = max(maxDepth, max(fetchDepth(texel + ivec2(0, 2)), fetchDepth(texel + ivec2(1, 2))));
+
+	if (extraColumn && extraRow)
+		maxDepth = max(maxDepth, fetchDepth(texel + ivec2(2, 2)));
+}
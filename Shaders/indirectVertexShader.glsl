@@ -0,0 +1,52 @@
+#version 330 core
+
+// Same as basicVertexShader.glsl, but the model matrix comes from a buffer indexed by the draw
+layout(location = 0) in vec3 vertexPosition_modelSpace; 
+
+layout(location = 1) in vec2 vertexUV;
+
+layout(location = 2) in vec3 vertexNormal_modelSpace;
+
+// Index of the draw, an instanced attribute offset by the command's base instance
+layout(location = 3) in uint drawID;
+
+// Output data, for each fragment
+out vec2 UV;
+out vec3 position_worldSpace;
+out vec3 eyeDirection_cameraSpace;
+out vec3 normal_cameraSpace;
+
+// Stays constant for every draw
+uniform mat4 VP;
+uniform mat4 V;
+
+// Model matrix of every draw, four texels per matrix
+uniform samplerBuffer modelMatrices;
+
+void main()
+{
+	int matrixTexel = int(drawID) * 4;
+	mat4 M = mat4(
+		texelFetch(modelMatrices, matrixTexel),
+		texelFetch(modelMatrices, matrixTexel + 1),
+		texelFetch(modelMatrices, matrixTexel + 2),
+		texelFetch(modelMatrices, matrixTexel + 3));
+
+	// Position of vertex in worldspace
+	position_worldSpace = (M * vec4(vertexPosition_modelSpace, 1)).xyz;
+
+	// Outputs position transformed by the camera
+	gl_Position = VP * vec4(position_worldSpace, 1);
+
+	// Vector from vertex to camera center, with camera center at origin in camera space
+	// Lights are uploaded in camera space, so the fragment shader gets light directions from this too
+	vec3 vertexPosition_cameraSpace = ( V * vec4(position_worldSpace,1)).xyz;
+	eyeDirection_cameraSpace = vec3(0,0,0) - vertexPosition_cameraSpace;
+
+	// Vertex Normal in camera space.
+	// Only correct if Model Matrix does not scale the model ! Use its inverse transpose if not.
+	normal_cameraSpace = (V * M * vec4(vertexNormal_modelSpace, 0)).xyz;
+
+	// UV of the vertex
+    UV = vertexUV;
+}
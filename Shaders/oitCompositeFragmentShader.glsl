@@ -0,0 +1,27 @@
+#version 330 core
+
+// Resolves the weighted blended transparency targets over what is already in the framebuffer
+in vec2 UV;
+
+out vec4 color;
+
+// rgb: sum of color * alpha * weight, a: product of (1 - alpha), the revealage
+uniform sampler2D	accumulationSampler;
+// r: sum of alpha * weight
+uniform sampler2D	weightSampler;
+
+void main()
+{
+	vec4 accumulation = texture(accumulationSampler, UV);
+	float revealage = accumulation.a;
+
+	// Nothing transparent covered this pixel
+	if (revealage == 1.0)
+		discard;
+
+	float weightSum = texture(weightSampler, UV).r;
+	vec3 averageColor = accumulation.rgb / max(weightSum, 1e-5);
+
+	// Blended with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+	color = vec4(averageColor, 1.0 - revealage);
+}
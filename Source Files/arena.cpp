@@ -0,0 +1,103 @@
+#include "arena.hpp"
+
+#include <stdlib.h>		// For malloc, free
+#include <atomic>
+#include <algorithm>	// For max
+
+static std::atomic<unsigned long long> heapCount(0);
+static std::atomic<unsigned long long> heapBytes(0);
+
+void recordHeapAllocation(size_t bytes)
+{
+	heapCount.fetch_add(1, std::memory_order_relaxed);
+	heapBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+unsigned long long heapAllocationCount()
+{
+	return heapCount.load();
+}
+
+unsigned long long heapAllocationBytes()
+{
+	return heapBytes.load();
+}
+
+void resetHeapAllocationStats()
+{
+	heapCount.store(0);
+	heapBytes.store(0);
+}
+
+Arena::Arena(size_t blockSize) : blockSize(blockSize), offset(0), usedBytes(0)
+{
+}
+
+Arena::~Arena()
+{
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+		free(blocks[i].data);
+}
+
+void Arena::addBlock(size_t minimumSize)
+{
+	Block block;
+	block.size = std::max(blockSize, minimumSize);
+	block.data = (char*)malloc(block.size);
+
+	// The blocks are heap allocations too
+	recordHeapAllocation(block.size);
+
+	blocks.push_back(block);
+	offset = 0;
+}
+
+void * Arena::allocate(size_t bytes, size_t alignment)
+{
+	if (blocks.empty())
+		addBlock(bytes + alignment);
+
+	// Round up to the alignment, in address space since blocks are only aligned for malloc
+	size_t address = (size_t)(blocks.back().data + offset);
+	size_t padding = (alignment - address % alignment) % alignment;
+
+	if (offset + padding + bytes > blocks.back().size)
+	{
+		// Vectors grow geometrically, so keep blocks at least twice the last one to match
+		addBlock(std::max(bytes + alignment, blocks.back().size * 2));
+		address = (size_t)blocks.back().data;
+		padding = (alignment - address % alignment) % alignment;
+	}
+
+	offset += padding;
+	void * result = blocks.back().data + offset;
+	offset += bytes;
+	usedBytes += bytes;
+
+	return result;
+}
+
+void Arena::reset()
+{
+	if (blocks.size() > 1)
+	{
+		size_t total = capacity();
+
+		for (unsigned int i = 0; i < blocks.size(); ++i)
+			free(blocks[i].data);
+		blocks.clear();
+
+		addBlock(total);
+	}
+
+	offset = 0;
+	usedBytes = 0;
+}
+
+size_t Arena::capacity() const
+{
+	size_t total = 0;
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+		total += blocks[i].size;
+	return total;
+}
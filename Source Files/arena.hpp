@@ -0,0 +1,84 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+// Heap allocations made by the loaders, for comparing runs with and without an arena
+// Only allocations going through ArenaAllocator are counted, safe to call from several threads
+void recordHeapAllocation(size_t bytes);
+unsigned long long heapAllocationCount();
+unsigned long long heapAllocationBytes();
+void resetHeapAllocationStats();
+
+// Linear allocator for per asset temporaries
+// Allocating is a pointer bump, nothing is freed until reset, which makes all of it reusable for the next asset.
+// Not thread safe, give each thread its own.
+class Arena
+{
+public:
+	explicit Arena(size_t blockSize = 1 << 20);
+	~Arena();
+
+	void * allocate(size_t bytes, size_t alignment);
+
+	// Releases everything allocated so far
+	// If the last asset needed several blocks they are merged into one, so an asset of the same size fits without growing
+	void reset();
+
+	size_t bytesUsed() const { return usedBytes; }
+	size_t capacity() const;
+
+private:
+	Arena(const Arena &);
+	Arena & operator=(const Arena &);
+
+	void addBlock(size_t minimumSize);
+
+	struct Block
+	{
+		char * data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t blockSize;
+	size_t offset;		// Into the last block
+	size_t usedBytes;
+};
+
+// Standard allocator over an Arena, for containers of loader temporaries
+// Without an arena it uses the heap and counts every allocation with recordHeapAllocation.
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(Arena * arena = NULL) : arena(arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> & other) : arena(other.arena) {}
+
+	T * allocate(size_t count)
+	{
+		if (arena != NULL)
+			return (T*)arena->allocate(count * sizeof(T), alignof(T));
+
+		recordHeapAllocation(count * sizeof(T));
+		return (T*)::operator new(count * sizeof(T));
+	}
+
+	// Arena memory is only given back on reset
+	void deallocate(T * pointer, size_t)
+	{
+		if (arena == NULL)
+			::operator delete(pointer);
+	}
+
+	Arena * arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> & a, const ArenaAllocator<U> & b) { return a.arena == b.arena; }
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> & a, const ArenaAllocator<U> & b) { return a.arena != b.arena; }
@@ -0,0 +1,475 @@
+#include "assetCache.hpp"
+
+#include <stdio.h>
+#include <string.h>		// For memcpy, memset, memcmp
+#include <cmath>		// For floor, fabs
+
+// Fraction of [minimum, maximum] as a 16 bit integer
+static unsigned short quantize(float value, float minimum, float maximum)
+{
+	float extent = maximum - minimum;
+	if (extent <= 0.0f)
+		return 0;
+
+	return (unsigned short)floor(clamp((value - minimum) / extent, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+static float dequantize(unsigned short value, float minimum, float maximum)
+{
+	return minimum + (maximum - minimum) * (value / 65535.0f);
+}
+
+// -1 or 1, never 0, so normals on the axes fold correctly
+static float signNotZero(float value)
+{
+	return value < 0.0f ? -1.0f : 1.0f;
+}
+
+// Unit vector onto the octahedron, unfolded into a square
+static void encodeOctahedral(const vec3 & normal, short & out_x, short & out_y)
+{
+	float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	vec2 p = sum > 0.0f ? vec2(normal.x, normal.y) / sum : vec2(0.0f);
+
+	// Lower half folds over the diagonals
+	if (normal.z < 0.0f)
+		p = vec2((1.0f - std::fabs(p.y)) * signNotZero(p.x), (1.0f - std::fabs(p.x)) * signNotZero(p.y));
+
+	out_x = (short)floor(clamp(p.x, -1.0f, 1.0f) * 32767.0f + 0.5f);
+	out_y = (short)floor(clamp(p.y, -1.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+static vec3 decodeOctahedral(short x, short y)
+{
+	vec3 n(x / 32767.0f, y / 32767.0f, 0.0f);
+	n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+
+	if (n.z < 0.0f)
+	{
+		float fx = (1.0f - std::fabs(n.y)) * signNotZero(n.x);
+		float fy = (1.0f - std::fabs(n.x)) * signNotZero(n.y);
+		n.x = fx;
+		n.y = fy;
+	}
+
+	return normalize(n);
+}
+
+// Position, UV, normal and tangent, then the handedness bits
+static size_t meshVertexBytes(unsigned int vertexCount)
+{
+	return (size_t)vertexCount * 18 + (vertexCount + 7) / 8;
+}
+
+template <typename T>
+static void append(std::vector<unsigned char> & data, const T & value)
+{
+	size_t at = data.size();
+	data.resize(at + sizeof(T));
+	memcpy(&data[at], &value, sizeof(T));
+}
+
+template <typename T>
+static T readAt(const unsigned char * data, size_t & offset)
+{
+	T value;
+	memcpy(&value, data + offset, sizeof(T));
+	offset += sizeof(T);
+	return value;
+}
+
+void encodeMesh(
+	const std::vector<unsigned short> & indices,
+	const std::vector<vec3> & vertices,
+	const std::vector<vec2> & uvs,
+	const std::vector<vec3> & normals,
+	const std::vector<vec3> & tangents,
+	const std::vector<vec3> & bitangents,
+	EncodedMesh & out_mesh
+){
+	MeshCacheHeader & header = out_mesh.header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = ASSET_CACHE_VERSION;
+	header.vertexCount = (unsigned int)vertices.size();
+	header.indexCount = (unsigned int)indices.size();
+
+	// Ranges the vertex streams are quantized to
+	vec3 boundsMin(0.0f), boundsMax(0.0f);
+	vec2 uvMin(0.0f), uvMax(0.0f);
+	if (!vertices.empty())
+	{
+		boundsMin = boundsMax = vertices[0];
+		uvMin = uvMax = uvs[0];
+	}
+	for (unsigned int i = 1; i < vertices.size(); ++i)
+	{
+		boundsMin = min(boundsMin, vertices[i]);
+		boundsMax = max(boundsMax, vertices[i]);
+		uvMin = min(uvMin, uvs[i]);
+		uvMax = max(uvMax, uvs[i]);
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.boundsMin[axis] = boundsMin[axis];
+		header.boundsMax[axis] = boundsMax[axis];
+	}
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		header.uvMin[axis] = uvMin[axis];
+		header.uvMax[axis] = uvMax[axis];
+	}
+
+	std::vector<unsigned char> & data = out_mesh.data;
+	data.clear();
+	data.reserve(meshVertexBytes(header.vertexCount) + indices.size() * 2);
+
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+		for (int axis = 0; axis < 3; ++axis)
+			append(data, quantize(vertices[i][axis], boundsMin[axis], boundsMax[axis]));
+
+	for (unsigned int i = 0; i < uvs.size(); ++i)
+		for (int axis = 0; axis < 2; ++axis)
+			append(data, quantize(uvs[i][axis], uvMin[axis], uvMax[axis]));
+
+	for (unsigned int i = 0; i < normals.size(); ++i)
+	{
+		short x, y;
+		encodeOctahedral(normals[i], x, y);
+		append(data, x);
+		append(data, y);
+	}
+
+	for (unsigned int i = 0; i < tangents.size(); ++i)
+	{
+		short x, y;
+		encodeOctahedral(tangents[i], x, y);
+		append(data, x);
+		append(data, y);
+	}
+
+	// Mirrored UVs
+	size_t handednessStart = data.size();
+	data.resize(handednessStart + (vertices.size() + 7) / 8, 0);
+	for (unsigned int i = 0; i < bitangents.size(); ++i)
+	{
+		if (dot(cross(normals[i], tangents[i]), bitangents[i]) < 0.0f)
+			data[handednessStart + i / 8] |= (unsigned char)(1 << (i % 8));
+	}
+
+	// After cache and fetch optimization consecutive indices are close, so most deltas fit in one byte
+	size_t indexStart = data.size();
+	int previous = 0;
+	for (unsigned int i = 0; i < indices.size(); ++i)
+	{
+		int delta = (int)indices[i] - previous;
+		unsigned int zigzag = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+		previous = indices[i];
+
+		while (zigzag >= 0x80)
+		{
+			data.push_back((unsigned char)(zigzag | 0x80));
+			zigzag >>= 7;
+		}
+		data.push_back((unsigned char)zigzag);
+	}
+
+	header.indexBytes = (unsigned int)(data.size() - indexStart);
+}
+
+// Pixels are 4 bytes
+static bool samePixel(const unsigned char * a, const unsigned char * b)
+{
+	return memcmp(a, b, 4) == 0;
+}
+
+static void encodeRuns(const unsigned char * pixels, unsigned int pixelCount, std::vector<unsigned char> & data)
+{
+	unsigned int i = 0;
+	while (i < pixelCount)
+	{
+		unsigned int run = 1;
+		while (i + run < pixelCount && run < 129 && samePixel(pixels + i * 4, pixels + (i + run) * 4))
+			++run;
+
+		if (run >= 2)
+		{
+			data.push_back((unsigned char)(run + 126));
+			data.insert(data.end(), pixels + i * 4, pixels + i * 4 + 4);
+			i += run;
+			continue;
+		}
+
+		// Literals up to the next repeat
+		unsigned int end = i + 1;
+		while (end < pixelCount && end - i < 128 && !(end + 1 < pixelCount && samePixel(pixels + end * 4, pixels + (end + 1) * 4)))
+			++end;
+
+		data.push_back((unsigned char)(end - i - 1));
+		data.insert(data.end(), pixels + i * 4, pixels + end * 4);
+		i = end;
+	}
+}
+
+void encodeImage(const std::vector<Image> & levels, EncodedImage & out_image)
+{
+	ImageCacheHeader & header = out_image.header;
+	memset(&header, 0, sizeof(header));
+	header.magic = IMAGE_CACHE_MAGIC;
+	header.version = ASSET_CACHE_VERSION;
+	header.levelCount = (unsigned int)levels.size();
+
+	if (!levels.empty())
+	{
+		header.width = levels[0].width;
+		header.height = levels[0].height;
+	}
+
+	out_image.data.clear();
+	for (unsigned int level = 0; level < levels.size(); ++level)
+	{
+		const Image & image = levels[level];
+		header.pixelBytes += (unsigned int)image.pixels.size();
+		encodeRuns(image.pixels.data(), (unsigned int)image.pixels.size() / 4, out_image.data);
+	}
+
+	header.encodedBytes = (unsigned int)out_image.data.size();
+}
+
+void encodeMeshlets(
+	const std::vector<Meshlet> & meshlets,
+	const std::vector<unsigned int> & meshletVertices,
+	const std::vector<unsigned char> & meshletTriangles,
+	const std::vector<vec3> & vertices,
+	const std::vector<vec2> & uvs,
+	const std::vector<vec3> & normals,
+	EncodedMeshlets & out_meshlets
+){
+	MeshletCacheHeader & header = out_meshlets.header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MESHLET_CACHE_MAGIC;
+	header.version = ASSET_CACHE_VERSION;
+	header.meshletCount = (unsigned int)meshlets.size();
+	header.maxVertices = MESHLET_MAX_VERTICES;
+	header.maxTriangles = MESHLET_MAX_TRIANGLES;
+	header.vertexStride = sizeof(MeshletVertex);
+	header.tableOffset = sizeof(MeshletCacheHeader);
+
+	vec3 boundsMin(0.0f), boundsMax(0.0f);
+	if (!vertices.empty())
+		boundsMin = boundsMax = vertices[0];
+	for (unsigned int i = 1; i < vertices.size(); ++i)
+	{
+		boundsMin = min(boundsMin, vertices[i]);
+		boundsMax = max(boundsMax, vertices[i]);
+	}
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.boundsMin[axis] = boundsMin[axis];
+		header.boundsMax[axis] = boundsMax[axis];
+	}
+
+	unsigned long long dataStart = header.tableOffset + meshlets.size() * sizeof(MeshletCacheEntry);
+
+	out_meshlets.table.resize(meshlets.size());
+	out_meshlets.data.clear();
+
+	for (unsigned int m = 0; m < meshlets.size(); ++m)
+	{
+		const Meshlet & meshlet = meshlets[m];
+		MeshletCacheEntry & entry = out_meshlets.table[m];
+
+		entry.dataOffset = dataStart + out_meshlets.data.size();
+		entry.vertexCount = meshlet.vertexCount;
+		entry.triangleCount = meshlet.triangleCount;
+		entry.radius = meshlet.radius;
+		entry.coneCutoff = meshlet.coneCutoff;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			entry.center[axis] = meshlet.center[axis];
+			entry.coneApex[axis] = meshlet.coneApex[axis];
+			entry.coneAxis[axis] = meshlet.coneAxis[axis];
+		}
+
+		size_t chunkStart = out_meshlets.data.size();
+
+		for (unsigned int i = 0; i < meshlet.vertexCount; ++i)
+		{
+			unsigned int v = meshletVertices[meshlet.vertexOffset + i];
+
+			MeshletVertex vertex;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				vertex.position[axis] = vertices[v][axis];
+				vertex.normal[axis] = normals[v][axis];
+			}
+			vertex.uv[0] = uvs[v].x;
+			vertex.uv[1] = uvs[v].y;
+
+			append(out_meshlets.data, vertex);
+		}
+
+		const unsigned char * triangles = &meshletTriangles[meshlet.triangleOffset * 3];
+		out_meshlets.data.insert(out_meshlets.data.end(), triangles, triangles + meshlet.triangleCount * 3);
+
+		// Keep the next chunk's floats aligned
+		while (out_meshlets.data.size() % 4 != 0)
+			out_meshlets.data.push_back(0);
+
+		entry.dataBytes = (unsigned int)(out_meshlets.data.size() - chunkStart);
+	}
+}
+
+static bool writeFile(const char * path, const void * header, size_t headerSize, const std::vector<unsigned char> & data)
+{
+	FILE * file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Could not open %s for writing\n", path);
+		return false;
+	}
+
+	bool written = fwrite(header, 1, headerSize, file) == headerSize;
+	if (written && !data.empty())
+		written = fwrite(data.data(), 1, data.size(), file) == data.size();
+
+	fclose(file);
+
+	if (!written)
+		printf("Could not write %s\n", path);
+
+	return written;
+}
+
+bool writeMeshCache(const char * path, const EncodedMesh & mesh)
+{
+	return writeFile(path, &mesh.header, sizeof(mesh.header), mesh.data);
+}
+
+bool writeImageCache(const char * path, const EncodedImage & image)
+{
+	return writeFile(path, &image.header, sizeof(image.header), image.data);
+}
+
+bool writeMeshletCache(const char * path, const EncodedMeshlets & meshlets)
+{
+	FILE * file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Could not open %s for writing\n", path);
+		return false;
+	}
+
+	bool written = fwrite(&meshlets.header, 1, sizeof(meshlets.header), file) == sizeof(meshlets.header);
+	if (written && !meshlets.table.empty())
+		written = fwrite(meshlets.table.data(), sizeof(MeshletCacheEntry), meshlets.table.size(), file) == meshlets.table.size();
+	if (written && !meshlets.data.empty())
+		written = fwrite(meshlets.data.data(), 1, meshlets.data.size(), file) == meshlets.data.size();
+
+	fclose(file);
+
+	if (!written)
+		printf("Could not write %s\n", path);
+
+	return written;
+}
+
+bool loadMeshCache(
+	const char * path,
+	std::vector<unsigned short> & out_indices,
+	std::vector<vec3> & out_vertices,
+	std::vector<vec2> & out_uvs,
+	std::vector<vec3> & out_normals,
+	std::vector<vec3> & out_tangents,
+	std::vector<vec3> & out_bitangents
+){
+	FILE * file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		printf("Could not open mesh cache %s\n", path);
+		return false;
+	}
+
+	MeshCacheHeader header;
+	if (fread(&header, 1, sizeof(header), file) != sizeof(header) || header.magic != MESH_CACHE_MAGIC || header.version != ASSET_CACHE_VERSION)
+	{
+		printf("%s is not a mesh cache, or from another version\n", path);
+		fclose(file);
+		return false;
+	}
+
+	size_t vertexBytes = meshVertexBytes(header.vertexCount);
+	std::vector<unsigned char> data(vertexBytes + header.indexBytes);
+	bool read = data.empty() || fread(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+
+	if (!read)
+	{
+		printf("Mesh cache %s is truncated\n", path);
+		return false;
+	}
+
+	out_vertices.resize(header.vertexCount);
+	out_uvs.resize(header.vertexCount);
+	out_normals.resize(header.vertexCount);
+	out_tangents.resize(header.vertexCount);
+	out_bitangents.resize(header.vertexCount);
+	out_indices.resize(header.indexCount);
+
+	size_t offset = 0;
+	for (unsigned int i = 0; i < header.vertexCount; ++i)
+		for (int axis = 0; axis < 3; ++axis)
+			out_vertices[i][axis] = dequantize(readAt<unsigned short>(data.data(), offset), header.boundsMin[axis], header.boundsMax[axis]);
+
+	for (unsigned int i = 0; i < header.vertexCount; ++i)
+		for (int axis = 0; axis < 2; ++axis)
+			out_uvs[i][axis] = dequantize(readAt<unsigned short>(data.data(), offset), header.uvMin[axis], header.uvMax[axis]);
+
+	for (unsigned int i = 0; i < header.vertexCount; ++i)
+	{
+		short x = readAt<short>(data.data(), offset);
+		short y = readAt<short>(data.data(), offset);
+		out_normals[i] = decodeOctahedral(x, y);
+	}
+
+	for (unsigned int i = 0; i < header.vertexCount; ++i)
+	{
+		short x = readAt<short>(data.data(), offset);
+		short y = readAt<short>(data.data(), offset);
+		out_tangents[i] = decodeOctahedral(x, y);
+	}
+
+	for (unsigned int i = 0; i < header.vertexCount; ++i)
+	{
+		bool mirrored = (data[offset + i / 8] & (1 << (i % 8))) != 0;
+		out_bitangents[i] = cross(out_normals[i], out_tangents[i]) * (mirrored ? -1.0f : 1.0f);
+	}
+	offset += (header.vertexCount + 7) / 8;
+
+	int previous = 0;
+	for (unsigned int i = 0; i < header.indexCount; ++i)
+	{
+		unsigned int zigzag = 0;
+		int shift = 0;
+		unsigned char byte;
+		do
+		{
+			if (offset >= data.size())
+			{
+				printf("Mesh cache %s has a broken index stream\n", path);
+				return false;
+			}
+
+			byte = data[offset++];
+			zigzag |= (unsigned int)(byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+
+		int delta = (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+		previous += delta;
+		out_indices[i] = (unsigned short)previous;
+	}
+
+	return true;
+}
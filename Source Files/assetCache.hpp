@@ -0,0 +1,141 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "imageLoader.hpp"
+#include "meshletBuilder.hpp"
+
+using namespace glm;
+
+// Binary cache files written by the asset converter, read back without parsing text
+
+const unsigned int MESH_CACHE_MAGIC = 0x4348534D;	// "MSHC"
+const unsigned int IMAGE_CACHE_MAGIC = 0x43474D49;	// "IMGC"
+const unsigned int MESHLET_CACHE_MAGIC = 0x43544C4D;	// "MLTC"
+const unsigned int ASSET_CACHE_VERSION = 3;	// 2: image pixels are RGBA, 3: meshes have tangents
+
+// Start of a mesh cache file, followed by the vertex streams and the index stream
+// Positions are 16 bit fractions of the bounds, UVs of the UV range, normals and tangents 16 bit octahedral.
+// The bitangent is cross(normal, tangent), negated where a bit of the handedness stream is set, 8 vertices per byte.
+// Indices are zigzagged deltas from the previous index, as variable length integers.
+struct MeshCacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	float boundsMin[3];
+	float boundsMax[3];
+	float uvMin[2];
+	float uvMax[2];
+	unsigned int indexBytes;	// Size of the index stream
+};
+
+// Start of an image cache file, followed by every mip level from largest to smallest, RGBA run length encoded by pixel
+// Each run starts with a byte n: below 128 n + 1 literal pixels follow, otherwise one pixel repeated n - 126 times
+struct ImageCacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int width;
+	unsigned int height;
+	unsigned int levelCount;
+	unsigned int pixelBytes;	// Pixels of every level before encoding
+	unsigned int encodedBytes;
+};
+
+// Start of a meshlet cache file, laid out to be mapped and paged in one meshlet at a time
+// The header is followed by the meshlet table, then every meshlet's chunk: its vertices as MeshletVertex,
+// then 3 local byte indices per triangle, padded to 4 bytes. Chunks are not compressed so they upload straight from the mapping.
+struct MeshletCacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int meshletCount;
+	unsigned int maxVertices;
+	unsigned int maxTriangles;
+	unsigned int vertexStride;
+	float boundsMin[3];
+	float boundsMax[3];
+	unsigned long long tableOffset;
+};
+
+// The table is small and stays resident, the chunks it points at are streamed
+struct MeshletCacheEntry
+{
+	unsigned long long dataOffset;	// From the start of the file
+	unsigned int dataBytes;
+	unsigned int vertexCount;
+	unsigned int triangleCount;
+	float center[3];
+	float radius;
+	float coneApex[3];
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+struct MeshletVertex
+{
+	float position[3];
+	float uv[2];
+	float normal[3];
+};
+
+// Mesh in its cache layout, in memory
+struct EncodedMesh
+{
+	MeshCacheHeader header;
+	std::vector<unsigned char> data;	// Everything after the header
+};
+
+struct EncodedImage
+{
+	ImageCacheHeader header;
+	std::vector<unsigned char> data;
+};
+
+struct EncodedMeshlets
+{
+	MeshletCacheHeader header;
+	std::vector<MeshletCacheEntry> table;
+	std::vector<unsigned char> data;	// Every chunk, in table order
+};
+
+void encodeMesh(
+	const std::vector<unsigned short> & indices,
+	const std::vector<vec3> & vertices,
+	const std::vector<vec2> & uvs,
+	const std::vector<vec3> & normals,
+	const std::vector<vec3> & tangents,
+	const std::vector<vec3> & bitangents,
+	EncodedMesh & out_mesh
+);
+
+// levels[0] is the full image, each next one half the size
+void encodeImage(const std::vector<Image> & levels, EncodedImage & out_image);
+
+// Meshlets as built by buildMeshlets, with the vertex attributes of the indexed mesh
+void encodeMeshlets(
+	const std::vector<Meshlet> & meshlets,
+	const std::vector<unsigned int> & meshletVertices,
+	const std::vector<unsigned char> & meshletTriangles,
+	const std::vector<vec3> & vertices,
+	const std::vector<vec2> & uvs,
+	const std::vector<vec3> & normals,
+	EncodedMeshlets & out_meshlets
+);
+
+bool writeMeshCache(const char * path, const EncodedMesh & mesh);
+bool writeImageCache(const char * path, const EncodedImage & image);
+bool writeMeshletCache(const char * path, const EncodedMeshlets & meshlets);
+
+// Reads and decodes a mesh cache back into indexVBO_TBN's layout
+bool loadMeshCache(
+	const char * path,
+	std::vector<unsigned short> & out_indices,
+	std::vector<vec3> & out_vertices,
+	std::vector<vec2> & out_uvs,
+	std::vector<vec3> & out_normals,
+	std::vector<vec3> & out_tangents,
+	std::vector<vec3> & out_bitangents
+);
@@ -0,0 +1,733 @@
+// Offline converter from a directory of OBJ, BMP and TGA files to binary caches
+// Every asset goes through parse -> index -> optimize -> compress -> write, each stage on its own threads
+// with bounded queues in between, so the slowest stage sets the pace and shows up in the stage report.
+
+// Include standard headers
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glm/glm.hpp>
+#include <common/objBasicLoader.hpp>	// For loading obj files
+#include <common/vboindexer.hpp>	// For VBO indexing
+#include <common/imageLoader.hpp>	// For decoding BMP and TGA files
+#include <common/meshOptimizer.hpp>	// For vertex cache and fetch order
+#include <common/assetCache.hpp>	// For the binary cache format
+#include <common/boundedQueue.hpp>	// For passing assets between stages
+#include <common/arena.hpp>	// For loader temporaries
+#include <common/meshletBuilder.hpp>	// For splitting meshes into meshlets
+#include <common/tangentSpace.hpp>	// For tangent bases
+
+#include <algorithm>	// For max
+#include <atomic>
+#include <chrono>	// For high_resolution_clock
+#include <ctype.h>	// For tolower
+#include <filesystem>	// For listing the input directory
+#include <string>
+#include <string.h>	// For strcmp
+#include <thread>
+#include <vector>
+
+using namespace glm;
+
+enum Stage
+{
+	STAGE_PARSE,
+	STAGE_INDEX,
+	STAGE_OPTIMIZE,
+	STAGE_COMPRESS,
+	STAGE_WRITE,
+	STAGE_COUNT
+};
+
+const char * STAGE_NAMES[STAGE_COUNT] = { "parse", "index", "optimize", "compress", "write" };
+
+// One asset on its way through the pipeline, each stage replaces the previous stage's data with its own
+struct AssetJob
+{
+	std::string inputPath;
+	std::string outputPath;
+	std::string name;
+	bool isImage;
+	bool meshlets;		// Mesh is written as a streamable meshlet cache instead
+	unsigned long long inputBytes;
+
+	// Mesh, as triangles after parsing and indexed after that
+	std::vector<vec3> vertices;
+	std::vector<vec2> uvs;
+	std::vector<vec3> normals;
+	std::vector<vec3> tangents;			// Whole mesh caches only, meshlet vertices have no room for them
+	std::vector<vec3> bitangents;
+	std::vector<unsigned short> indices;
+	std::vector<unsigned int> indices32;	// Meshlet builds are not limited to 16 bit indices
+	float missRatioBefore;
+	float missRatioAfter;
+
+	// Meshlets, with their vertices as indices into the mesh
+	std::vector<Meshlet> meshletList;
+	std::vector<unsigned int> meshletVertices;
+	std::vector<unsigned char> meshletTriangles;
+
+	// Image, the full size level first
+	std::vector<Image> levels;
+
+	EncodedMesh encodedMesh;
+	EncodedImage encodedImage;
+	EncodedMeshlets encodedMeshlets;
+	unsigned long long outputBytes;
+};
+
+// Time a stage's workers spent on each part of their loop, in microseconds summed over its threads
+struct StageStats
+{
+	int threadCount;
+	std::atomic<unsigned long long> items;
+	std::atomic<unsigned long long> inputBytes;
+	std::atomic<long long> busy;		// Processing an asset
+	std::atomic<long long> starved;	// Waiting for the previous stage
+	std::atomic<long long> blocked;	// Waiting for room in the next stage's queue
+	std::atomic<int> activeThreads;
+};
+
+struct Options
+{
+	const char * inputDirectory = NULL;
+	const char * outputDirectory = NULL;
+	int threadsPerStage = 2;
+	int queueCapacity = 8;
+	bool meshlets = false;
+	bool benchTangents = false;
+	bool benchImages = false;
+};
+
+bool parseOptions(int argc, char * argv[], Options & options);
+
+// Does one stage's work on a job, false drops the job
+bool processJob(Stage stage, AssetJob & job, Arena & arena, ImageDecoder & decoder);
+
+// Halves an image with a 2x2 box filter, odd edges reuse their last row or column
+void downsampleImage(const Image & source, Image & out_image);
+
+void runStage(Stage stage, BoundedQueue<AssetJob*> & input, BoundedQueue<AssetJob*> * output, StageStats & stats);
+
+// Times tangent basis generation on every OBJ in the directory at increasing thread counts, nothing is written
+int benchmarkTangents(const char * inputDirectory);
+
+// Times image decoding on every BMP and TGA in the directory, scalar and SIMD at increasing thread counts
+int benchmarkImages(const char * inputDirectory);
+
+long long microsecondsSince(const std::chrono::high_resolution_clock::time_point & start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main( int argc, char * argv[] )
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return -1;
+	}
+
+	if (options.benchTangents)
+		return benchmarkTangents(options.inputDirectory);
+
+	if (options.benchImages)
+		return benchmarkImages(options.inputDirectory);
+
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+	fs::create_directories(options.outputDirectory, error);
+	if (error)
+	{
+		printf("Could not create output directory %s\n", options.outputDirectory);
+		return -1;
+	}
+
+	// Every OBJ, BMP and TGA directly in the input directory
+	std::vector<AssetJob*> jobs;
+	for (fs::directory_iterator it(options.inputDirectory, error), end; !error && it != end; it.increment(error))
+	{
+		if (!it->is_regular_file())
+			continue;
+
+		std::string extension = it->path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		if (extension != ".obj" && extension != ".bmp" && extension != ".tga")
+			continue;
+
+		AssetJob * job = new AssetJob();
+		job->inputPath = it->path().string();
+		job->name = it->path().filename().string();
+		job->isImage = extension != ".obj";
+		job->meshlets = options.meshlets && !job->isImage;
+		job->outputPath = (fs::path(options.outputDirectory) / it->path().stem()).string() + (job->isImage ? ".imgc" : job->meshlets ? ".mltc" : ".mshc");
+		job->inputBytes = it->file_size();
+		job->missRatioBefore = 0.0f;
+		job->missRatioAfter = 0.0f;
+		job->outputBytes = 0;
+		jobs.push_back(job);
+	}
+
+	if (error)
+	{
+		printf("Could not read input directory %s\n", options.inputDirectory);
+		return -1;
+	}
+
+	if (jobs.empty())
+	{
+		printf("No OBJ, BMP or TGA files in %s\n", options.inputDirectory);
+		return 0;
+	}
+
+	// Queue feeding each stage, the last stage has no output
+	std::vector<BoundedQueue<AssetJob*>*> queues;
+	for (int stage = 0; stage < STAGE_COUNT; ++stage)
+		queues.push_back(new BoundedQueue<AssetJob*>(options.queueCapacity));
+
+	StageStats stats[STAGE_COUNT];
+	std::vector<std::thread> threads;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (int stage = 0; stage < STAGE_COUNT; ++stage)
+	{
+		stats[stage].threadCount = options.threadsPerStage;
+		stats[stage].items = 0;
+		stats[stage].inputBytes = 0;
+		stats[stage].busy = 0;
+		stats[stage].starved = 0;
+		stats[stage].blocked = 0;
+		stats[stage].activeThreads = options.threadsPerStage;
+
+		BoundedQueue<AssetJob*> * output = stage + 1 < STAGE_COUNT ? queues[stage + 1] : NULL;
+		for (int t = 0; t < options.threadsPerStage; ++t)
+			threads.push_back(std::thread(runStage, (Stage)stage, std::ref(*queues[stage]), output, std::ref(stats[stage])));
+	}
+
+	// Feed the first stage, blocking whenever parsing falls behind
+	unsigned long long totalInputBytes = 0;
+	for (unsigned int i = 0; i < jobs.size(); ++i)
+	{
+		totalInputBytes += jobs[i]->inputBytes;
+		queues[STAGE_PARSE]->push(jobs[i]);
+	}
+	queues[STAGE_PARSE]->close();
+
+	for (unsigned int i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	double wallSeconds = microsecondsSince(start) / 1000000.0;
+
+	for (unsigned int i = 0; i < queues.size(); ++i)
+		delete queues[i];
+
+	// Per stage report, the stage with the highest utilization is the bottleneck
+	unsigned long long converted = stats[STAGE_WRITE].items;
+	printf("\nConverted %llu of %u assets in %.3f s, %.2f MB read\n", converted, (unsigned int)jobs.size(), wallSeconds, totalInputBytes / (1024.0 * 1024.0));
+	printf("%-10s %8s %8s %10s %8s %10s %10s %10s %10s\n", "stage", "threads", "items", "busy ms", "util %", "starved %", "blocked %", "items/s", "MB/s");
+
+	int bottleneck = 0;
+	double bottleneckUtilization = -1.0;
+	for (int stage = 0; stage < STAGE_COUNT; ++stage)
+	{
+		double threadMicroseconds = wallSeconds * 1000000.0 * stats[stage].threadCount;
+		double utilization = threadMicroseconds > 0.0 ? 100.0 * stats[stage].busy / threadMicroseconds : 0.0;
+		double starved = threadMicroseconds > 0.0 ? 100.0 * stats[stage].starved / threadMicroseconds : 0.0;
+		double blocked = threadMicroseconds > 0.0 ? 100.0 * stats[stage].blocked / threadMicroseconds : 0.0;
+
+		// Throughput while busy, what the stage could sustain if it never waited
+		double busySeconds = stats[stage].busy / 1000000.0;
+		double itemsPerSecond = busySeconds > 0.0 ? stats[stage].items / busySeconds * stats[stage].threadCount : 0.0;
+		double megabytesPerSecond = busySeconds > 0.0 ? stats[stage].inputBytes / (1024.0 * 1024.0) / busySeconds * stats[stage].threadCount : 0.0;
+
+		printf("%-10s %8d %8llu %10.2f %8.1f %10.1f %10.1f %10.1f %10.2f\n", STAGE_NAMES[stage], stats[stage].threadCount, (unsigned long long)stats[stage].items,
+			stats[stage].busy / 1000.0, utilization, starved, blocked, itemsPerSecond, megabytesPerSecond);
+
+		if (utilization > bottleneckUtilization)
+		{
+			bottleneckUtilization = utilization;
+			bottleneck = stage;
+		}
+	}
+
+	printf("Bottleneck: %s\n", STAGE_NAMES[bottleneck]);
+
+	return converted == jobs.size() ? 0 : 1;
+}
+
+void runStage(Stage stage, BoundedQueue<AssetJob*> & input, BoundedQueue<AssetJob*> * output, StageStats & stats)
+{
+	// Each worker reuses one arena and one decoder for every asset it handles
+	// Workers already decode several images at once, so rows are not split further
+	Arena arena;
+	ImageDecoder decoder(1);
+
+	while (true)
+	{
+		auto waitBegin = std::chrono::high_resolution_clock::now();
+
+		AssetJob * job;
+		if (!input.pop(job))
+			break;
+
+		auto workBegin = std::chrono::high_resolution_clock::now();
+		stats.starved += std::chrono::duration_cast<std::chrono::microseconds>(workBegin - waitBegin).count();
+
+		bool succeeded = processJob(stage, *job, arena, decoder);
+		arena.reset();
+
+		auto workEnd = std::chrono::high_resolution_clock::now();
+		stats.busy += std::chrono::duration_cast<std::chrono::microseconds>(workEnd - workBegin).count();
+
+		if (!succeeded)
+		{
+			printf("%s: %s failed\n", job->name.c_str(), STAGE_NAMES[stage]);
+			delete job;
+			continue;
+		}
+
+		stats.items++;
+		stats.inputBytes += job->inputBytes;
+
+		if (output == NULL)
+		{
+			delete job;
+			continue;
+		}
+
+		output->push(job);
+		stats.blocked += microsecondsSince(workEnd);
+	}
+
+	// Last worker out lets the next stage drain and finish
+	if (--stats.activeThreads == 0 && output != NULL)
+		output->close();
+}
+
+bool processJob(Stage stage, AssetJob & job, Arena & arena, ImageDecoder & decoder)
+{
+	switch (stage)
+	{
+	case STAGE_PARSE:
+		if (job.isImage)
+		{
+			job.levels.resize(1);
+			return decoder.decode(job.inputPath.c_str(), job.levels[0]);
+		}
+		if (!loadOBJ(job.inputPath.c_str(), job.vertices, job.uvs, job.normals, &arena))
+			return false;
+
+		if (job.vertices.empty())
+		{
+			printf("%s: no triangles\n", job.name.c_str());
+			return false;
+		}
+		return true;
+
+	case STAGE_INDEX:
+	{
+		if (job.isImage)
+			return true;
+
+		std::vector<vec3> indexed_vertices;
+		std::vector<vec2> indexed_uvs;
+		std::vector<vec3> indexed_normals;
+
+		if (job.meshlets)
+		{
+			indexVBO(job.vertices, job.uvs, job.normals, job.indices32, indexed_vertices, indexed_uvs, indexed_normals, &arena);
+		}
+		else
+		{
+			// Per triangle first, then averaged over the shared vertices while indexing
+			// Workers already index several meshes at once, so triangles are not split further
+			std::vector<vec3> tangents;
+			std::vector<vec3> bitangents;
+			computeTangentBasis(job.vertices, job.uvs, tangents, bitangents, 1);
+			indexVBO_TBN(job.vertices, job.uvs, job.normals, tangents, bitangents, job.indices, indexed_vertices, indexed_uvs, indexed_normals, job.tangents, job.bitangents, &arena);
+		}
+
+		// Whole mesh caches use 16 bit indices, meshlets only index within themselves
+		if (!job.meshlets && indexed_vertices.size() > 65536)
+		{
+			printf("%s: %u unique vertices, more than 16 bit indices can address\n", job.name.c_str(), (unsigned int)indexed_vertices.size());
+			return false;
+		}
+
+		job.vertices.swap(indexed_vertices);
+		job.uvs.swap(indexed_uvs);
+		job.normals.swap(indexed_normals);
+		return true;
+	}
+
+	case STAGE_OPTIMIZE:
+		if (job.isImage)
+		{
+			// Full mip chain down to 1x1
+			while (job.levels.back().width > 1 || job.levels.back().height > 1)
+			{
+				Image level;
+				downsampleImage(job.levels.back(), level);
+				job.levels.push_back(level);
+			}
+			return true;
+		}
+
+		if (job.meshlets)
+		{
+			// Cache order keeps neighbouring triangles together, so meshlets come out compact
+			optimizeVertexCache(job.indices32, (unsigned int)job.vertices.size());
+			buildMeshlets(job.indices32, job.vertices, job.meshletList, job.meshletVertices, job.meshletTriangles);
+			return true;
+		}
+
+		job.missRatioBefore = averageCacheMissRatio(job.indices, (unsigned int)job.vertices.size());
+		optimizeVertexCache(job.indices, (unsigned int)job.vertices.size());
+		optimizeVertexFetch(job.indices, job.vertices, job.uvs, job.normals, &job.tangents, &job.bitangents);
+		job.missRatioAfter = averageCacheMissRatio(job.indices, (unsigned int)job.vertices.size());
+		return true;
+
+	case STAGE_COMPRESS:
+		if (job.isImage)
+		{
+			encodeImage(job.levels, job.encodedImage);
+			std::vector<Image>().swap(job.levels);
+			job.outputBytes = sizeof(ImageCacheHeader) + job.encodedImage.data.size();
+			return true;
+		}
+
+		if (job.meshlets)
+		{
+			encodeMeshlets(job.meshletList, job.meshletVertices, job.meshletTriangles, job.vertices, job.uvs, job.normals, job.encodedMeshlets);
+			job.outputBytes = sizeof(MeshletCacheHeader) + job.encodedMeshlets.table.size() * sizeof(MeshletCacheEntry) + job.encodedMeshlets.data.size();
+			return true;
+		}
+
+		encodeMesh(job.indices, job.vertices, job.uvs, job.normals, job.tangents, job.bitangents, job.encodedMesh);
+		job.outputBytes = sizeof(MeshCacheHeader) + job.encodedMesh.data.size();
+		return true;
+
+	case STAGE_WRITE:
+		if (job.isImage)
+		{
+			if (!writeImageCache(job.outputPath.c_str(), job.encodedImage))
+				return false;
+
+			printf("%s: %ux%u, %u levels, %.1f KB -> %.1f KB\n", job.name.c_str(), job.encodedImage.header.width, job.encodedImage.header.height,
+				job.encodedImage.header.levelCount, job.inputBytes / 1024.0, job.outputBytes / 1024.0);
+			return true;
+		}
+
+		if (job.meshlets)
+		{
+			if (!writeMeshletCache(job.outputPath.c_str(), job.encodedMeshlets))
+				return false;
+
+			printf("%s: %u vertices, %u triangles, %u meshlets, %.1f KB -> %.1f KB\n", job.name.c_str(), (unsigned int)job.vertices.size(),
+				(unsigned int)job.indices32.size() / 3, (unsigned int)job.meshletList.size(), job.inputBytes / 1024.0, job.outputBytes / 1024.0);
+			return true;
+		}
+
+		if (!writeMeshCache(job.outputPath.c_str(), job.encodedMesh))
+			return false;
+
+		printf("%s: %u vertices, %u triangles, ACMR %.3f -> %.3f, %.1f KB -> %.1f KB\n", job.name.c_str(), (unsigned int)job.vertices.size(),
+			(unsigned int)job.indices.size() / 3, job.missRatioBefore, job.missRatioAfter, job.inputBytes / 1024.0, job.outputBytes / 1024.0);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void downsampleImage(const Image & source, Image & out_image)
+{
+	out_image.width = std::max(1u, source.width / 2);
+	out_image.height = std::max(1u, source.height / 2);
+	out_image.pixels.resize((size_t)out_image.width * out_image.height * 4);
+
+	for (unsigned int y = 0; y < out_image.height; ++y)
+	{
+		unsigned int y0 = std::min(y * 2, source.height - 1);
+		unsigned int y1 = std::min(y * 2 + 1, source.height - 1);
+
+		for (unsigned int x = 0; x < out_image.width; ++x)
+		{
+			unsigned int x0 = std::min(x * 2, source.width - 1);
+			unsigned int x1 = std::min(x * 2 + 1, source.width - 1);
+
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				unsigned int sum =
+					source.pixels[((size_t)y0 * source.width + x0) * 4 + channel] +
+					source.pixels[((size_t)y0 * source.width + x1) * 4 + channel] +
+					source.pixels[((size_t)y1 * source.width + x0) * 4 + channel] +
+					source.pixels[((size_t)y1 * source.width + x1) * 4 + channel];
+
+				out_image.pixels[((size_t)y * out_image.width + x) * 4 + channel] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+bool parseOptions(int argc, char * argv[], Options & options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			options.threadsPerStage = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc)
+		{
+			options.queueCapacity = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--meshlets") == 0)
+		{
+			options.meshlets = true;
+		}
+		else if (strcmp(argv[i], "--bench-tangents") == 0)
+		{
+			options.benchTangents = true;
+		}
+		else if (strcmp(argv[i], "--bench-images") == 0)
+		{
+			options.benchImages = true;
+		}
+		else if (argv[i][0] != '-' && options.inputDirectory == NULL)
+		{
+			options.inputDirectory = argv[i];
+		}
+		else if (argv[i][0] != '-' && options.outputDirectory == NULL)
+		{
+			options.outputDirectory = argv[i];
+		}
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			printf("Usage: assetConverter <input directory> <output directory> [--threads N] [--queue N] [--meshlets]\n       assetConverter <input directory> --bench-tangents|--bench-images\n");
+			return false;
+		}
+	}
+
+	// The benchmarks only read
+	if (options.inputDirectory == NULL || (options.outputDirectory == NULL && !options.benchTangents && !options.benchImages))
+	{
+		printf("Usage: assetConverter <input directory> <output directory> [--threads N] [--queue N] [--meshlets]\n       assetConverter <input directory> --bench-tangents|--bench-images\n");
+		return false;
+	}
+
+	if (options.threadsPerStage < 1 || options.queueCapacity < 1)
+	{
+		printf("--threads and --queue need to be at least 1\n");
+		return false;
+	}
+
+	return true;
+}
+
+int benchmarkTangents(const char * inputDirectory)
+{
+	namespace fs = std::filesystem;
+
+	// Thread counts to time, doubling up to every hardware thread
+	unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(hardwareThreads);
+
+	const int RUNS = 5;
+	int meshCount = 0;
+	bool deterministic = true;
+
+	std::error_code error;
+	for (fs::directory_iterator it(inputDirectory, error), end; !error && it != end; it.increment(error))
+	{
+		std::string extension = it->path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		if (!it->is_regular_file() || extension != ".obj")
+			continue;
+
+		std::vector<vec3> vertices;
+		std::vector<vec2> uvs;
+		std::vector<vec3> normals;
+		if (!loadOBJ(it->path().string().c_str(), vertices, uvs, normals) || vertices.empty())
+			continue;
+
+		++meshCount;
+		unsigned int triangleCount = (unsigned int)vertices.size() / 3;
+		double inputMegabytes = (vertices.size() * sizeof(vec3) + uvs.size() * sizeof(vec2)) / (1024.0 * 1024.0);
+
+		printf("\n%s: %u triangles\n", it->path().filename().string().c_str(), triangleCount);
+		printf("%8s %10s %14s %10s %10s %10s\n", "threads", "best ms", "triangles/s", "MB/s", "speedup", "index ms");
+
+		std::vector<unsigned int> referenceIndices;
+		std::vector<vec3> referenceTangents;
+		std::vector<vec3> referenceBitangents;
+		double singleThreadMS = 0.0;
+
+		for (unsigned int c = 0; c < threadCounts.size(); ++c)
+		{
+			std::vector<vec3> tangents;
+			std::vector<vec3> bitangents;
+
+			// Best of several runs, the first one also pays for faulting the output in
+			// Small meshes are split anyway, so every thread count really runs and is checked
+			double bestMS = 0.0;
+			unsigned int threadsUsed = 0;
+			for (int run = 0; run < RUNS; ++run)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				threadsUsed = computeTangentBasis(vertices, uvs, tangents, bitangents, threadCounts[c], 1);
+				double ms = microsecondsSince(start) / 1000.0;
+				if (run == 0 || ms < bestMS)
+					bestMS = ms;
+			}
+
+			if (c == 0)
+				singleThreadMS = bestMS;
+
+			std::vector<unsigned int> indices;
+			std::vector<vec3> indexedVertices;
+			std::vector<vec2> indexedUVs;
+			std::vector<vec3> indexedNormals;
+			std::vector<vec3> indexedTangents;
+			std::vector<vec3> indexedBitangents;
+
+			auto indexStart = std::chrono::high_resolution_clock::now();
+			indexVBO_TBN(vertices, uvs, normals, tangents, bitangents, indices, indexedVertices, indexedUVs, indexedNormals, indexedTangents, indexedBitangents);
+			double indexMS = microsecondsSince(indexStart) / 1000.0;
+
+			// The averaged basis has to come out bit for bit the same whatever the thread count
+			if (c == 0)
+			{
+				referenceIndices = indices;
+				referenceTangents = indexedTangents;
+				referenceBitangents = indexedBitangents;
+			}
+			else if (indices != referenceIndices ||
+				memcmp(indexedTangents.data(), referenceTangents.data(), indexedTangents.size() * sizeof(vec3)) != 0 ||
+				memcmp(indexedBitangents.data(), referenceBitangents.data(), indexedBitangents.size() * sizeof(vec3)) != 0)
+			{
+				printf("Tangents with %u threads differ from 1 thread\n", threadsUsed);
+				deterministic = false;
+			}
+
+			double seconds = bestMS / 1000.0;
+			printf("%8u %10.3f %14.0f %10.1f %10.2f %10.2f\n", threadsUsed, bestMS, seconds > 0.0 ? triangleCount / seconds : 0.0,
+				seconds > 0.0 ? inputMegabytes / seconds : 0.0, bestMS > 0.0 ? singleThreadMS / bestMS : 0.0, indexMS);
+		}
+	}
+
+	if (error)
+	{
+		printf("Could not read input directory %s\n", inputDirectory);
+		return -1;
+	}
+
+	if (meshCount == 0)
+	{
+		printf("No OBJ files in %s\n", inputDirectory);
+		return 0;
+	}
+
+	printf("\nTangent bases %s across thread counts\n", deterministic ? "identical" : "DIFFER");
+	return deterministic ? 0 : 1;
+}
+
+int benchmarkImages(const char * inputDirectory)
+{
+	namespace fs = std::filesystem;
+
+	unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(hardwareThreads);
+
+	const int RUNS = 10;
+	int imageCount = 0;
+	bool identical = true;
+
+	std::error_code error;
+	for (fs::directory_iterator it(inputDirectory, error), end; !error && it != end; it.increment(error))
+	{
+		std::string extension = it->path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		if (!it->is_regular_file() || (extension != ".bmp" && extension != ".tga"))
+			continue;
+
+		std::string path = it->path().string();
+		double fileMegabytes = it->file_size() / (1024.0 * 1024.0);
+
+		Image reference;
+		if (!ImageDecoder(1, false).decode(path.c_str(), reference))
+			continue;
+
+		++imageCount;
+		double pixelMegabytes = reference.pixels.size() / (1024.0 * 1024.0);
+
+		printf("\n%s: %ux%u, %.2f MB file, %.2f MB RGBA\n", it->path().filename().string().c_str(), reference.width, reference.height, fileMegabytes, pixelMegabytes);
+		printf("%8s %8s %10s %12s %12s\n", "simd", "threads", "best ms", "file MB/s", "RGBA MB/s");
+
+		for (int simd = 0; simd < 2; ++simd)
+		{
+			unsigned int previousThreads = 0;
+			for (unsigned int c = 0; c < threadCounts.size(); ++c)
+			{
+				// One decoder for every run, like a loader reusing its staging memory
+				ImageDecoder decoder(threadCounts[c], simd == 1);
+				if (simd == 1 && !decoder.usesSIMD())
+					break;
+
+				double bestMS = 0.0;
+				const Image * image = NULL;
+				for (int run = 0; run < RUNS; ++run)
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					image = decoder.decode(path.c_str());
+					double ms = microsecondsSince(start) / 1000.0;
+					if (run == 0 || ms < bestMS)
+						bestMS = ms;
+				}
+
+				// Every path has to produce the scalar single threaded result
+				if (image == NULL || image->pixels != reference.pixels)
+				{
+					printf("Decoding with %s and %u threads differs from scalar\n", simd == 1 ? "SIMD" : "scalar", decoder.threadsUsed());
+					identical = false;
+				}
+
+				// The image is too small to split any further, more threads would only repeat the last row
+				if (decoder.threadsUsed() == previousThreads)
+					break;
+				previousThreads = decoder.threadsUsed();
+
+				double seconds = bestMS / 1000.0;
+				printf("%8s %8u %10.3f %12.1f %12.1f\n", simd == 1 ? "ssse3" : "scalar", decoder.threadsUsed(), bestMS,
+					seconds > 0.0 ? fileMegabytes / seconds : 0.0, seconds > 0.0 ? pixelMegabytes / seconds : 0.0);
+			}
+		}
+	}
+
+	if (error)
+	{
+		printf("Could not read input directory %s\n", inputDirectory);
+		return -1;
+	}
+
+	if (imageCount == 0)
+	{
+		printf("No BMP or TGA files in %s\n", inputDirectory);
+		return 0;
+	}
+
+	printf("\nDecoded images %s across paths\n", identical ? "identical" : "DIFFER");
+	return identical ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+#define _USE_MATH_DEFINES
+#include "benchmark.hpp"
+
+#include <algorithm>	// For sort
+#include <cmath>		// For fmod, sqrt
+
+// Catmull-Rom spline through p1 and p2, u in [0, 1]
+static float catmullRom(float p0, float p1, float p2, float p3, float u)
+{
+	float u2 = u * u;
+	float u3 = u2 * u;
+
+	return 0.5f * ((2.0f * p1) +
+		(-p0 + p2) * u +
+		(2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+		(-p0 + 3.0f * p1 - 3.0f * p2 + p3) * u3);
+}
+
+static vec3 catmullRom(const vec3 & p0, const vec3 & p1, const vec3 & p2, const vec3 & p3, float u)
+{
+	return vec3(
+		catmullRom(p0.x, p1.x, p2.x, p3.x, u),
+		catmullRom(p0.y, p1.y, p2.y, p3.y, u),
+		catmullRom(p0.z, p1.z, p2.z, p3.z, u));
+}
+
+bool CameraPath::loadFromFile(const char * path)
+{
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL)
+	{
+		printf("Could not open camera path file\n");
+		return false;
+	}
+
+	keys.clear();
+
+	CameraKey key;
+	while (fscanf(file, "%f %f %f %f %f %f", &key.t, &key.position.x, &key.position.y, &key.position.z, &key.horizontalAngle, &key.verticalAngle) == 6)
+	{
+		keys.push_back(key);
+	}
+
+	fclose(file);
+
+	// Need at least a segment to interpolate
+	if (keys.size() < 2)
+	{
+		printf("Camera path needs at least two keys\n");
+		return false;
+	}
+
+	// Recordings start at whatever time the session had, rebase to zero
+	float start = keys[0].t;
+	for (unsigned int i = 0; i < keys.size(); ++i)
+		keys[i].t -= start;
+
+	return true;
+}
+
+void CameraPath::makeDefaultOrbit(float radius, float height, float duration)
+{
+	const int KEY_COUNT = 16;
+
+	keys.clear();
+
+	for (int i = 0; i <= KEY_COUNT; ++i)
+	{
+		float angle = 2.0f * (float)M_PI * i / KEY_COUNT;
+
+		CameraKey key;
+		key.t = duration * i / KEY_COUNT;
+		key.position = vec3(radius * sin(angle), height, radius * cos(angle));
+
+		// Look back at the origin, same spherical convention as computeMatriciesFromInputs
+		vec3 toOrigin = normalize(-key.position);
+		key.horizontalAngle = atan2(toOrigin.x, toOrigin.z);
+		key.verticalAngle = asin(toOrigin.y);
+
+		// Keep the angle continuous so the spline does not swing around at the wrap
+		if (i > 0)
+		{
+			while (key.horizontalAngle - keys.back().horizontalAngle > M_PI)	key.horizontalAngle -= 2.0f * (float)M_PI;
+			while (key.horizontalAngle - keys.back().horizontalAngle < -M_PI)	key.horizontalAngle += 2.0f * (float)M_PI;
+		}
+
+		keys.push_back(key);
+	}
+}
+
+void CameraPath::sample(float t, vec3 & out_position, float & out_horizontalAngle, float & out_verticalAngle) const
+{
+	if (keys.empty())
+		return;
+
+	if (keys.size() == 1 || duration() <= 0.0f)
+	{
+		out_position = keys[0].position;
+		out_horizontalAngle = keys[0].horizontalAngle;
+		out_verticalAngle = keys[0].verticalAngle;
+		return;
+	}
+
+	t = fmod(t, duration());
+
+	// Find the segment containing t
+	unsigned int i = 0;
+	while (i + 2 < keys.size() && keys[i + 1].t <= t)
+		++i;
+
+	// Neighbouring keys, clamped at the ends of the path
+	const CameraKey & k0 = keys[i > 0 ? i - 1 : i];
+	const CameraKey & k1 = keys[i];
+	const CameraKey & k2 = keys[i + 1];
+	const CameraKey & k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+
+	float segment = k2.t - k1.t;
+	float u = segment > 0.0f ? clamp((t - k1.t) / segment, 0.0f, 1.0f) : 0.0f;
+
+	out_position		= catmullRom(k0.position, k1.position, k2.position, k3.position, u);
+	out_horizontalAngle	= catmullRom(k0.horizontalAngle, k1.horizontalAngle, k2.horizontalAngle, k3.horizontalAngle, u);
+	out_verticalAngle	= catmullRom(k0.verticalAngle, k1.verticalAngle, k2.verticalAngle, k3.verticalAngle, u);
+}
+
+float CameraPath::duration() const
+{
+	return keys.empty() ? 0.0f : keys.back().t;
+}
+
+CameraRecorder::CameraRecorder() : file(NULL)
+{
+}
+
+CameraRecorder::~CameraRecorder()
+{
+	if (file != NULL)
+		fclose(file);
+}
+
+bool CameraRecorder::open(const char * path)
+{
+	file = fopen(path, "w");
+
+	if (file == NULL)
+	{
+		printf("Could not open camera recording file\n");
+		return false;
+	}
+
+	return true;
+}
+
+void CameraRecorder::record(float t, const vec3 & position, float horizontalAngle, float verticalAngle)
+{
+	if (file == NULL)
+		return;
+
+	fprintf(file, "%f %f %f %f %f %f\n", t, position.x, position.y, position.z, horizontalAngle, verticalAngle);
+}
+
+void BenchmarkStats::addFrame(double frameMS)
+{
+	frameTimes.push_back(frameMS);
+}
+
+void BenchmarkStats::setCounter(const std::string & name, double value)
+{
+	for (unsigned int i = 0; i < counters.size(); ++i)
+	{
+		if (counters[i].first == name)
+		{
+			counters[i].second = value;
+			return;
+		}
+	}
+
+	counters.push_back(std::make_pair(name, value));
+}
+
+// Nearest rank percentile, expects a sorted array
+double BenchmarkStats::percentile(std::vector<double> & sorted, double p) const
+{
+	if (sorted.empty())
+		return 0.0;
+
+	size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+	rank = std::min(std::max(rank, (size_t)1), sorted.size());
+
+	return sorted[rank - 1];
+}
+
+void BenchmarkStats::printSummary() const
+{
+	std::vector<double> sorted(frameTimes);
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (unsigned int i = 0; i < sorted.size(); ++i)
+		sum += sorted[i];
+
+	double mean = sorted.empty() ? 0.0 : sum / sorted.size();
+
+	printf("%u frames, mean %f ms, median %f ms, p99 %f ms\n", (unsigned int)sorted.size(), mean,
+		percentile(sorted, 50.0),
+		percentile(sorted, 99.0));
+
+	for (unsigned int i = 0; i < counters.size(); ++i)
+		printf("%s: %f\n", counters[i].first.c_str(), counters[i].second);
+}
+
+bool BenchmarkStats::writeJSON(const char * path, const char * scene, float timeStep) const
+{
+	FILE *file = fopen(path, "w");
+
+	if (file == NULL)
+	{
+		printf("Could not open benchmark output file\n");
+		return false;
+	}
+
+	std::vector<double> sorted(frameTimes);
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (unsigned int i = 0; i < sorted.size(); ++i)
+		sum += sorted[i];
+
+	double mean = sorted.empty() ? 0.0 : sum / sorted.size();
+
+	double variance = 0.0;
+	for (unsigned int i = 0; i < sorted.size(); ++i)
+		variance += (sorted[i] - mean) * (sorted[i] - mean);
+
+	double stddev = sorted.empty() ? 0.0 : sqrt(variance / sorted.size());
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"scene\": \"%s\",\n", scene);
+	fprintf(file, "  \"timeStep\": %f,\n", timeStep);
+	fprintf(file, "  \"frameCount\": %u,\n", (unsigned int)frameTimes.size());
+
+	fprintf(file, "  \"summary\": {\n");
+	fprintf(file, "    \"meanMS\": %f,\n", mean);
+	fprintf(file, "    \"minMS\": %f,\n", sorted.empty() ? 0.0 : sorted.front());
+	fprintf(file, "    \"maxMS\": %f,\n", sorted.empty() ? 0.0 : sorted.back());
+	fprintf(file, "    \"medianMS\": %f,\n", percentile(sorted, 50.0));
+	fprintf(file, "    \"p95MS\": %f,\n", percentile(sorted, 95.0));
+	fprintf(file, "    \"p99MS\": %f,\n", percentile(sorted, 99.0));
+	fprintf(file, "    \"stddevMS\": %f,\n", stddev);
+	fprintf(file, "    \"meanFPS\": %f\n", mean > 0.0 ? 1000.0 / mean : 0.0);
+	fprintf(file, "  },\n");
+
+	fprintf(file, "  \"counters\": {");
+	for (unsigned int i = 0; i < counters.size(); ++i)
+		fprintf(file, "%s\n    \"%s\": %f", i == 0 ? "" : ",", counters[i].first.c_str(), counters[i].second);
+	fprintf(file, "%s},\n", counters.empty() ? "" : "\n  ");
+
+	// Frame times in submission order, for plotting spikes
+	fprintf(file, "  \"frameMS\": [");
+	for (unsigned int i = 0; i < frameTimes.size(); ++i)
+		fprintf(file, "%s%s%f", i == 0 ? "" : ",", i % 8 == 0 ? "\n    " : " ", frameTimes[i]);
+	fprintf(file, "\n  ]\n");
+
+	fprintf(file, "}\n");
+
+	fclose(file);
+	return true;
+}
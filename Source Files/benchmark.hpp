@@ -0,0 +1,70 @@
+#pragma once
+#include <stdio.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+using namespace glm;
+
+// One camera pose on a scripted path, at time t in seconds
+struct CameraKey
+{
+	float t;
+	vec3 position;
+	float horizontalAngle;
+	float verticalAngle;
+};
+
+// Camera path replayed by the benchmark mode
+// Poses between keys are interpolated with a Catmull-Rom spline so the motion is smooth
+class CameraPath
+{
+public:
+	// Reads a path recorded with --record, one "t x y z horizontal vertical" line per key
+	bool loadFromFile(const char * path);
+
+	// Orbit around the origin, used when no path file is given
+	void makeDefaultOrbit(float radius, float height, float duration);
+
+	// Pose at time t, the path loops once t passes the last key
+	void sample(float t, vec3 & out_position, float & out_horizontalAngle, float & out_verticalAngle) const;
+
+	float duration() const;
+
+private:
+	std::vector<CameraKey> keys;
+};
+
+// Writes camera poses every frame so an interactive session can be replayed with --bench --path
+class CameraRecorder
+{
+public:
+	CameraRecorder();
+	~CameraRecorder();
+
+	bool open(const char * path);
+	void record(float t, const vec3 & position, float horizontalAngle, float verticalAngle);
+
+private:
+	FILE *file;
+};
+
+// Per frame timings of a benchmark run
+class BenchmarkStats
+{
+public:
+	void addFrame(double frameMS);
+
+	// Extra values written in the "counters" object of the report, e.g. culled object counts
+	void setCounter(const std::string & name, double value);
+
+	// Prints the summary and writes every frame plus the summary statistics as JSON
+	void printSummary() const;
+	bool writeJSON(const char * path, const char * scene, float timeStep) const;
+
+private:
+	double percentile(std::vector<double> & sorted, double p) const;
+
+	std::vector<double> frameTimes;
+	std::vector<std::pair<std::string, double>> counters;
+};
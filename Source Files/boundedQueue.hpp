@@ -0,0 +1,60 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed capacity queue between threads
+// push blocks while full so a fast producer can not run ahead of a slow consumer, pop blocks while empty.
+// Once closed, pop drains what is left and then returns false.
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+	// False if the queue was closed before there was room
+	bool push(const T & item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+
+		if (closed)
+			return false;
+
+		items.push_back(item);
+		notEmpty.notify_one();
+		return true;
+	}
+
+	bool pop(T & out_item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+
+		if (items.empty())
+			return false;
+
+		out_item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	// No more pushes, wakes everyone waiting
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+
+private:
+	std::deque<T> items;
+	size_t capacity;
+	bool closed;
+
+	std::mutex mutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+};
@@ -0,0 +1,214 @@
+#include "hiZBuffer.hpp"
+
+#include <common/shader.hpp>	// For loading shaders
+
+#include <string.h>		// For memcpy
+#include <algorithm>	// For min, max
+#include <cmath>		// For floor
+
+// Width of the level read back to the CPU, small enough to read every frame and test against quickly
+const int HIZ_READBACK_WIDTH = 64;
+
+HiZBuffer::HiZBuffer() :
+	depthWidth(0), depthHeight(0), levelCount(0), readbackLevel(0), readbackWidth(0), readbackHeight(0),
+	pyramidTexture(0), framebuffer(0), programID(0), sourceID(0), sourceSizeID(0),
+	readbackBuffer(0), readbackPending(false)
+{
+}
+
+HiZBuffer::~HiZBuffer()
+{
+	if (pyramidTexture != 0)
+	{
+		glDeleteTextures(1, &pyramidTexture);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteBuffers(1, &readbackBuffer);
+		glDeleteProgram(programID);
+	}
+}
+
+void HiZBuffer::init(int width, int height)
+{
+	depthWidth = width;
+	depthHeight = height;
+
+	// Level 0 is half the depth buffer, down to 1x1
+	int w = width, h = height;
+	do
+	{
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+		levelWidths.push_back(w);
+		levelHeights.push_back(h);
+	} while (w > 1 || h > 1);
+
+	levelCount = (int)levelWidths.size();
+
+	// First level small enough to read back
+	readbackLevel = 0;
+	while (readbackLevel + 1 < levelCount && levelWidths[readbackLevel] > HIZ_READBACK_WIDTH)
+		++readbackLevel;
+
+	readbackWidth = levelWidths[readbackLevel];
+	readbackHeight = levelHeights[readbackLevel];
+
+	glGenTextures(1, &pyramidTexture);
+	glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+	for (int level = 0; level < levelCount; ++level)
+		glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelWidths[level], levelHeights[level], 0, GL_RED, GL_FLOAT, NULL);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	glGenFramebuffers(1, &framebuffer);
+
+	glGenBuffers(1, &readbackBuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, readbackWidth * readbackHeight * sizeof(float), NULL, GL_STREAM_READ);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	programID = LoadShaders("fullScreenVertexShader.glsl", "hizDownsampleFragmentShader.glsl");
+	sourceID = glGetUniformLocation(programID, "sourceSampler");
+	sourceSizeID = glGetUniformLocation(programID, "sourceSize");
+}
+
+void HiZBuffer::build(GLuint depthTexture, const mat4 & viewProjection)
+{
+	// Keep the caller's state, the pyramid passes change the target, viewport and depth test
+	GLint previousFramebuffer;
+	GLint previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glUseProgram(programID);
+	glUniform1i(sourceID, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	for (int level = 0; level < levelCount; ++level)
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTexture, level);
+		glViewport(0, 0, levelWidths[level], levelHeights[level]);
+
+		if (level == 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, depthTexture);
+			glUniform2i(sourceSizeID, depthWidth, depthHeight);
+		}
+		else
+		{
+			// Only the level being read is visible to the sampler, so reading and writing the same texture is not a feedback loop
+			glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+			glUniform2i(sourceSizeID, levelWidths[level - 1], levelHeights[level - 1]);
+		}
+
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	// Copy the coarse level into the pixel buffer, mapped next frame once the GPU is done with it
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer);
+	glGetTexImage(GL_TEXTURE_2D, readbackLevel, GL_RED, GL_FLOAT, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readbackPending = true;
+	pendingViewProjection = viewProjection;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (blend)
+		glEnable(GL_BLEND);
+}
+
+void HiZBuffer::fetchReadback()
+{
+	if (!readbackPending)
+		return;
+
+	cpuDepth.resize(readbackWidth * readbackHeight);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer);
+	void * data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (data != NULL)
+	{
+		memcpy(&cpuDepth[0], data, cpuDepth.size() * sizeof(float));
+		cpuViewProjection = pendingViewProjection;
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		// Nothing to test against, everything counts as visible
+		cpuDepth.clear();
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readbackPending = false;
+}
+
+// Pixel containing a normalized device coordinate, clamped to the screen
+static int toPixel(float ndc, int size)
+{
+	return std::min((int)floor((clamp(ndc, -1.0f, 1.0f) * 0.5f + 0.5f) * size), size - 1);
+}
+
+bool HiZBuffer::isOccluded(const vec3 & boxMin, const vec3 & boxMax) const
+{
+	if (cpuDepth.empty())
+		return false;
+
+	// Screen rectangle and nearest depth of the box
+	vec2 rectMin(1.0f), rectMax(-1.0f);
+	float nearestDepth = 1.0f;
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		vec3 p((corner & 1) ? boxMax.x : boxMin.x, (corner & 2) ? boxMax.y : boxMin.y, (corner & 4) ? boxMax.z : boxMin.z);
+		vec4 clip = cpuViewProjection * vec4(p, 1.0f);
+
+		// Box reaches behind the camera, can not be projected so treat it as visible
+		if (clip.w <= 0.0f)
+			return false;
+
+		vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+		rectMin = min(rectMin, ndc);
+		rectMax = max(rectMax, ndc);
+		nearestDepth = std::min(nearestDepth, clip.z / clip.w * 0.5f + 0.5f);
+	}
+
+	// Off screen, that is for frustum culling to decide
+	if (rectMax.x < -1.0f || rectMax.y < -1.0f || rectMin.x > 1.0f || rectMin.y > 1.0f)
+		return false;
+
+	// Depth buffer pixels to readback texels, the last texel of each level also covers odd leftovers
+	int shift = readbackLevel + 1;
+	int x0 = std::min(toPixel(rectMin.x, depthWidth) >> shift, readbackWidth - 1);
+	int x1 = std::min(toPixel(rectMax.x, depthWidth) >> shift, readbackWidth - 1);
+	int y0 = std::min(toPixel(rectMin.y, depthHeight) >> shift, readbackHeight - 1);
+	int y1 = std::min(toPixel(rectMax.y, depthHeight) >> shift, readbackHeight - 1);
+
+	// Occluded only if the box is behind the farthest depth everywhere it covers
+	for (int y = y0; y <= y1; ++y)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			if (nearestDepth <= cpuDepth[y * readbackWidth + x])
+				return false;
+		}
+	}
+
+	return true;
+}
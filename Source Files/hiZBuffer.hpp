@@ -0,0 +1,51 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace glm;
+
+// Hierarchical Z buffer for occlusion culling
+// Every level holds the farthest depth of the 2x2 texels below it, built on the GPU from the depth prepass.
+// One coarse level is read back asynchronously and objects are tested against it on the CPU the next frame,
+// using the camera the pyramid was rendered with.
+class HiZBuffer
+{
+public:
+	HiZBuffer();
+	~HiZBuffer();
+
+	// Allocates the pyramid for a depth buffer of the given size and loads the downsample shader
+	void init(int depthWidth, int depthHeight);
+
+	// Builds the pyramid from the depth texture and starts reading back the coarse level
+	// viewProjection is the camera the depth was rendered with
+	void build(GLuint depthTexture, const mat4 & viewProjection);
+
+	// Makes the last readback available to isOccluded, call once per frame before culling
+	void fetchReadback();
+
+	// True if the world space box is behind the depth of the last readback
+	bool isOccluded(const vec3 & boxMin, const vec3 & boxMax) const;
+
+private:
+	int depthWidth, depthHeight;
+	int levelCount;
+	int readbackLevel;
+	int readbackWidth, readbackHeight;
+	std::vector<int> levelWidths, levelHeights;
+
+	GLuint pyramidTexture;
+	GLuint framebuffer;
+	GLuint programID;
+	GLuint sourceID, sourceSizeID;
+
+	// Readback goes through a pixel buffer so it does not stall the frame it is issued in
+	GLuint readbackBuffer;
+	bool readbackPending;
+	mat4 pendingViewProjection;
+
+	// Coarse level on the CPU and the camera it was rendered with
+	std::vector<float> cpuDepth;
+	mat4 cpuViewProjection;
+};
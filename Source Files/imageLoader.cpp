@@ -0,0 +1,412 @@
+#include "imageLoader.hpp"
+
+#include <stdio.h>
+#include <string.h>		// For memcpy
+#include <algorithm>	// For max, min
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define IMAGE_LOADER_SSSE3
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>		// For __cpuid
+#define SSSE3_FUNCTION
+#else
+#include <cpuid.h>		// For __get_cpuid
+#define SSSE3_FUNCTION __attribute__((target("ssse3")))
+#endif
+#endif
+
+// Larger sides are almost certainly a corrupt header, and would overflow the size math
+const unsigned int MAX_IMAGE_SIZE = 32768;
+
+// Below this many pixels per thread, starting threads costs more than it saves
+const unsigned int MIN_PIXELS_PER_THREAD = 1 << 16;
+
+// Headers are little endian and not aligned
+static unsigned short readU16(const unsigned char * bytes)
+{
+	return (unsigned short)(bytes[0] | (bytes[1] << 8));
+}
+
+static unsigned int readU32(const unsigned char * bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+// BGR or BGRA to RGBA
+static void swizzleRow(const unsigned char * source, unsigned char * destination, unsigned int width, unsigned int bytesPerPixel, bool keepAlpha)
+{
+	for (unsigned int x = 0; x < width; ++x)
+	{
+		destination[0] = source[2];
+		destination[1] = source[1];
+		destination[2] = source[0];
+		destination[3] = keepAlpha ? source[3] : 255;
+		source += bytesPerPixel;
+		destination += 4;
+	}
+}
+
+#ifdef IMAGE_LOADER_SSSE3
+
+static bool cpuHasSSSE3()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 9)) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1 << 9)) != 0;
+#endif
+}
+
+// 4 pixels per shuffle, the scalar version finishes the row
+SSSE3_FUNCTION static void swizzleRowSSSE3(const unsigned char * source, unsigned char * destination, unsigned int width, unsigned int bytesPerPixel, bool keepAlpha)
+{
+	unsigned int x = 0;
+
+	if (bytesPerPixel == 3)
+	{
+		// 12 of the 16 bytes loaded are used, stop while a whole load still fits in the row
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -128, 5, 4, 3, -128, 8, 7, 6, -128, 11, 10, 9, -128);
+		const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+		for (; x + 6 <= width; x += 4)
+		{
+			__m128i bgr = _mm_loadu_si128((const __m128i *)(source + x * 3));
+			_mm_storeu_si128((__m128i *)(destination + x * 4), _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha));
+		}
+	}
+	else
+	{
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		const __m128i alpha = keepAlpha ? _mm_setzero_si128() : _mm_set1_epi32((int)0xFF000000);
+
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128i bgra = _mm_loadu_si128((const __m128i *)(source + x * 4));
+			_mm_storeu_si128((__m128i *)(destination + x * 4), _mm_or_si128(_mm_shuffle_epi8(bgra, shuffle), alpha));
+		}
+	}
+
+	swizzleRow(source + x * bytesPerPixel, destination + x * 4, width - x, bytesPerPixel, keepAlpha);
+}
+
+#endif
+
+ImageDecoder::ImageDecoder(unsigned int threadCount, bool allowSIMD) : threadCount(threadCount), lastThreads(0), useSIMD(false)
+{
+	if (this->threadCount == 0)
+		this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+#ifdef IMAGE_LOADER_SSSE3
+	useSIMD = allowSIMD && cpuHasSSSE3();
+#endif
+
+	staging.width = 0;
+	staging.height = 0;
+}
+
+bool ImageDecoder::decode(const char * imagepath, Image & out_image, bool topRowFirst)
+{
+	if (!readFile(imagepath))
+		return false;
+
+	unsigned int width, height;
+	Layout layout;
+
+	// BMPs say what they are, TGAs do not, so anything else is taken to be a TGA
+	bool parsed = fileBytes.size() >= 2 && fileBytes[0] == 'B' && fileBytes[1] == 'M' ?
+		parseBMP(imagepath, width, height, layout) :
+		parseTGA(imagepath, width, height, layout);
+
+	if (!parsed)
+		return false;
+
+	out_image.width = width;
+	out_image.height = height;
+	out_image.pixels.resize((size_t)width * height * 4);
+
+	convertRows(layout, width, height, topRowFirst, out_image.pixels.data());
+
+	return true;
+}
+
+const Image * ImageDecoder::decode(const char * imagepath, bool topRowFirst)
+{
+	return decode(imagepath, staging, topRowFirst) ? &staging : NULL;
+}
+
+bool ImageDecoder::readFile(const char * imagepath)
+{
+	FILE *file = fopen(imagepath, "rb");
+
+	// Validate file opening
+	if (!file)
+	{
+		printf("Image %s could not be opened! \n", imagepath);
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (size <= 0)
+	{
+		printf("Image %s is empty \n", imagepath);
+		fclose(file);
+		return false;
+	}
+
+	// Kept from the last load, only grows
+	fileBytes.resize(size);
+	size_t read = fread(fileBytes.data(), 1, size, file);
+
+	// Close the file, we are done with it
+	fclose(file);
+
+	if (read != (size_t)size)
+	{
+		printf("Image %s could not be read \n", imagepath);
+		return false;
+	}
+
+	return true;
+}
+
+bool ImageDecoder::parseBMP(const char * imagepath, unsigned int & width, unsigned int & height, Layout & layout)
+{
+	const unsigned char * header = fileBytes.data();
+	size_t fileSize = fileBytes.size();
+
+	// 14 byte file header, then at least the 40 byte Windows 3 info header
+	if (fileSize < 54 || readU32(&header[0x0E]) < 40)
+	{
+		printf("Header for %s is not correct, or it is not a BMP \n", imagepath);
+		return false;
+	}
+
+	unsigned int dataPos		= readU32(&header[0x0A]);
+	unsigned int infoSize		= readU32(&header[0x0E]);
+	int signedWidth				= (int)readU32(&header[0x12]);
+	int signedHeight			= (int)readU32(&header[0x16]);	// Negative when rows are stored top to bottom
+	unsigned int bitsPerPixel	= readU16(&header[0x1C]);
+	unsigned int compression	= readU32(&header[0x1E]);
+
+	if (signedWidth <= 0 || signedHeight == 0 || signedWidth > (int)MAX_IMAGE_SIZE || signedHeight > (int)MAX_IMAGE_SIZE || signedHeight < -(int)MAX_IMAGE_SIZE)
+	{
+		printf("%s has an invalid size of %d x %d \n", imagepath, signedWidth, signedHeight);
+		return false;
+	}
+
+	width = signedWidth;
+	height = signedHeight < 0 ? -signedHeight : signedHeight;
+
+	layout.topDown = signedHeight < 0;
+	layout.bytesPerPixel = bitsPerPixel / 8;
+	layout.keepAlpha = false;
+
+	if (bitsPerPixel == 24 && compression == 0)
+	{
+		// BGR
+	}
+	else if (bitsPerPixel == 32 && compression == 0)
+	{
+		// BGRX, the fourth byte is unused
+	}
+	else if (bitsPerPixel == 32 && (compression == 3 || compression == 6))
+	{
+		// Channel masks follow the Windows 3 header, or are part of the V4 and V5 headers, at the same place
+		if (fileSize < 70)
+		{
+			printf("Header for %s is not correct, or it is not a BMP \n", imagepath);
+			return false;
+		}
+
+		if (readU32(&header[0x36]) != 0x00FF0000 || readU32(&header[0x3A]) != 0x0000FF00 || readU32(&header[0x3E]) != 0x000000FF)
+		{
+			printf("%s has channel masks other than BGRA, which are not supported \n", imagepath);
+			return false;
+		}
+
+		// Only the alpha bitfields compression and V3 and later headers have an alpha mask
+		layout.keepAlpha = (compression == 6 || infoSize >= 56) && readU32(&header[0x42]) == 0xFF000000;
+	}
+	else
+	{
+		printf("%s is %u bit with compression %u, only uncompressed 24 and 32 bit BMPs are supported \n", imagepath, bitsPerPixel, compression);
+		return false;
+	}
+
+	// Some BMP files are misformatted, guess missing information
+	if (dataPos == 0)	dataPos = 14 + infoSize + (infoSize == 40 && compression == 3 ? 12 : infoSize == 40 && compression == 6 ? 16 : 0);
+
+	// Rows are padded to 4 bytes, the last row's padding is allowed to be missing
+	layout.rowBytes = ((size_t)width * bitsPerPixel + 31) / 32 * 4;
+	size_t dataBytes = layout.rowBytes * (height - 1) + (size_t)width * layout.bytesPerPixel;
+
+	if (dataPos > fileSize || fileSize - dataPos < dataBytes)
+	{
+		printf("BMP file %s is shorter than its header says \n", imagepath);
+		return false;
+	}
+
+	layout.pixels = header + dataPos;
+	return true;
+}
+
+bool ImageDecoder::parseTGA(const char * imagepath, unsigned int & width, unsigned int & height, Layout & layout)
+{
+	const unsigned char * header = fileBytes.data();
+	size_t fileSize = fileBytes.size();
+
+	if (fileSize < 18)
+	{
+		printf("%s is not a BMP or TGA \n", imagepath);
+		return false;
+	}
+
+	unsigned int idLength		= header[0];
+	unsigned int colorMapType	= header[1];
+	unsigned int imageType		= header[2];	// 2 is true color, 10 true color run length encoded
+	unsigned int colorMapLength	= readU16(&header[5]);
+	unsigned int colorMapBits	= header[7];
+	unsigned int bitsPerPixel	= header[16];
+	unsigned int descriptor		= header[17];	// Alpha bits and origin
+
+	width = readU16(&header[12]);
+	height = readU16(&header[14]);
+
+	if (colorMapType > 1 || (imageType != 2 && imageType != 10) || (bitsPerPixel != 24 && bitsPerPixel != 32))
+	{
+		printf("%s is not a BMP, or a TGA that is not 24 or 32 bit true color \n", imagepath);
+		return false;
+	}
+
+	if (width == 0 || height == 0 || (descriptor & 0x10) != 0)
+	{
+		printf("%s has an empty size or is stored right to left, which is not supported \n", imagepath);
+		return false;
+	}
+
+	layout.bytesPerPixel = bitsPerPixel / 8;
+	layout.keepAlpha = bitsPerPixel == 32 && (descriptor & 0x0F) != 0;
+	layout.topDown = (descriptor & 0x20) != 0;
+	layout.rowBytes = (size_t)width * layout.bytesPerPixel;
+
+	// A color map can come with true color images too, it is skipped
+	size_t dataPos = 18 + idLength + (colorMapType == 1 ? colorMapLength * ((colorMapBits + 7) / 8) : 0);
+	size_t imageBytes = layout.rowBytes * height;
+
+	if (dataPos > fileSize)
+	{
+		printf("TGA file %s is shorter than its header says \n", imagepath);
+		return false;
+	}
+
+	if (imageType == 2)
+	{
+		if (fileSize - dataPos < imageBytes)
+		{
+			printf("TGA file %s is shorter than its header says \n", imagepath);
+			return false;
+		}
+
+		layout.pixels = header + dataPos;
+		return true;
+	}
+
+	// Each packet starts with a byte n: above 127 one pixel repeated n - 127 times follows, otherwise n + 1 literal pixels.
+	// Packets can run on from one row into the next, so the whole image is expanded before converting rows.
+	runBytes.resize(imageBytes);
+
+	const unsigned char * in = header + dataPos;
+	const unsigned char * end = header + fileSize;
+	unsigned char * out = runBytes.data();
+	size_t written = 0;
+
+	while (written < imageBytes)
+	{
+		if (in == end)
+		{
+			printf("TGA file %s ends in the middle of its pixels \n", imagepath);
+			return false;
+		}
+
+		bool repeat = (*in & 0x80) != 0;
+		size_t count = (*in & 0x7F) + 1;
+		size_t bytes = count * layout.bytesPerPixel;
+		++in;
+
+		size_t available = end - in;
+		if (bytes > imageBytes - written || available < (repeat ? layout.bytesPerPixel : bytes))
+		{
+			printf("TGA file %s has a corrupt run \n", imagepath);
+			return false;
+		}
+
+		if (repeat)
+		{
+			for (size_t i = 0; i < count; ++i)
+				memcpy(out + written + i * layout.bytesPerPixel, in, layout.bytesPerPixel);
+			in += layout.bytesPerPixel;
+		}
+		else
+		{
+			memcpy(out + written, in, bytes);
+			in += bytes;
+		}
+
+		written += bytes;
+	}
+
+	layout.pixels = runBytes.data();
+	return true;
+}
+
+void ImageDecoder::convertRows(const Layout & layout, unsigned int width, unsigned int height, bool topRowFirst, unsigned char * destination)
+{
+	unsigned int threads = std::max(1u, std::min(threadCount, (unsigned int)((size_t)width * height / MIN_PIXELS_PER_THREAD)));
+	threads = std::min(threads, height);
+	lastThreads = threads;
+
+	// Rows [first, last) of the output, flipped when the file stores them the other way around
+	bool flip = layout.topDown != topRowFirst;
+	auto convert = [&layout, width, height, flip, destination, this](unsigned int first, unsigned int last)
+	{
+		for (unsigned int y = first; y < last; ++y)
+		{
+			unsigned int sourceRow = flip ? height - 1 - y : y;
+			const unsigned char * source = layout.pixels + sourceRow * layout.rowBytes;
+			unsigned char * row = destination + (size_t)y * width * 4;
+
+#ifdef IMAGE_LOADER_SSSE3
+			if (useSIMD)
+			{
+				swizzleRowSSSE3(source, row, width, layout.bytesPerPixel, layout.keepAlpha);
+				continue;
+			}
+#endif
+			swizzleRow(source, row, width, layout.bytesPerPixel, layout.keepAlpha);
+		}
+	};
+
+	// Contiguous bands of rows, the last one on this thread
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < threads; ++t)
+	{
+		unsigned int first = (unsigned int)((unsigned long long)height * t / threads);
+		unsigned int last = (unsigned int)((unsigned long long)height * (t + 1) / threads);
+
+		if (t + 1 == threads)
+			convert(first, last);
+		else
+			workers.push_back(std::thread(convert, first, last));
+	}
+
+	for (unsigned int t = 0; t < workers.size(); ++t)
+		workers[t].join();
+}
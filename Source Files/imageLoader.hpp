@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>	// For size_t
+#include <vector>
+
+// Decoded image, RGBA with 8 bits per channel, rows bottom to top the way glTexImage2D takes them
+struct Image
+{
+	unsigned int width;
+	unsigned int height;
+	std::vector<unsigned char> pixels;
+};
+
+// Decodes 24 and 32 bit BMP files and raw or run length encoded 24 and 32 bit TGA files, no GL involved
+// so offline tools can use it. The file, the expanded runs and the staging image are kept between loads,
+// so a decoder that is reused only allocates when an image is bigger than every one before it.
+// Rows are swizzled with SSSE3 where the CPU has it, split over threadCount threads, 0 uses every hardware thread.
+class ImageDecoder
+{
+public:
+	ImageDecoder(unsigned int threadCount = 0, bool allowSIMD = true);
+
+	// Into the caller's image, its pixels only reallocate when they need to grow
+	// topRowFirst stores rows top to bottom instead, for meshes whose V is flipped for DDS textures
+	bool decode(const char * imagepath, Image & out_image, bool topRowFirst = false);
+
+	// Into the decoder's own staging image, valid until the next decode, NULL on failure
+	const Image * decode(const char * imagepath, bool topRowFirst = false);
+
+	bool usesSIMD() const { return useSIMD; }
+
+	// Threads the last decode actually ran on, small images get fewer than asked for
+	unsigned int threadsUsed() const { return lastThreads; }
+
+private:
+	// Where the source pixels are and how to turn them into RGBA
+	struct Layout
+	{
+		const unsigned char * pixels;
+		size_t rowBytes;			// Including padding
+		unsigned int bytesPerPixel;
+		bool keepAlpha;				// Otherwise alpha is opaque
+		bool topDown;
+	};
+
+	bool readFile(const char * imagepath);
+	bool parseBMP(const char * imagepath, unsigned int & width, unsigned int & height, Layout & layout);
+	bool parseTGA(const char * imagepath, unsigned int & width, unsigned int & height, Layout & layout);
+	void convertRows(const Layout & layout, unsigned int width, unsigned int height, bool topRowFirst, unsigned char * destination);
+
+	unsigned int threadCount;
+	unsigned int lastThreads;
+	bool useSIMD;
+
+	std::vector<unsigned char> fileBytes;
+	std::vector<unsigned char> runBytes;	// Run length encoded TGAs, expanded
+	Image staging;
+};
@@ -0,0 +1,141 @@
+#include "indirectDraw.hpp"
+
+#include <algorithm>	// For max
+
+// Attribute the draw index is read from, after position, UV and normal
+const GLuint DRAW_ID_ATTRIBUTE = 3;
+
+IndirectDrawList::IndirectDrawList() :
+	capacity(0), commandBuffer(0), drawIDBuffer(0), matrixBuffer(0), matrixTexture(0), programID(0), modelMatricesID(-1)
+{
+}
+
+IndirectDrawList::~IndirectDrawList()
+{
+	if (commandBuffer != 0)
+	{
+		glDeleteBuffers(1, &commandBuffer);
+		glDeleteBuffers(1, &drawIDBuffer);
+		glDeleteBuffers(1, &matrixBuffer);
+		glDeleteTextures(1, &matrixTexture);
+	}
+}
+
+void IndirectDrawList::init(unsigned int initialCapacity)
+{
+	glGenBuffers(1, &commandBuffer);
+	glGenBuffers(1, &drawIDBuffer);
+	glGenBuffers(1, &matrixBuffer);
+	glGenTextures(1, &matrixTexture);
+
+	// Four RGBA32F texels per matrix, one per column
+	glBindBuffer(GL_TEXTURE_BUFFER, matrixBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(mat4), NULL, GL_STREAM_DRAW);
+	glBindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, matrixBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	reserve(initialCapacity);
+}
+
+bool IndirectDrawList::multiDrawSupported()
+{
+	// Without ARB_base_instance the commands' baseInstance must be 0, so every draw would read draw ID 0
+	return GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+}
+
+void IndirectDrawList::reserve(unsigned int draws)
+{
+	if (draws <= capacity)
+		return;
+
+	// Grow geometrically so scenes that build up their draw count do not reallocate every frame
+	capacity = std::max(draws, capacity * 2);
+
+	std::vector<GLuint> drawIDs(capacity);
+	for (unsigned int i = 0; i < capacity; ++i)
+		drawIDs[i] = i;
+
+	glBindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+	glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(GLuint), drawIDs.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	commands.reserve(capacity);
+	modelMatrices.reserve(capacity);
+}
+
+void IndirectDrawList::clear()
+{
+	commands.clear();
+	modelMatrices.clear();
+}
+
+void IndirectDrawList::add(const MeshRecord & mesh, const mat4 & modelMatrix)
+{
+	DrawElementsIndirectCommand command;
+	command.count = mesh.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = mesh.firstIndex;
+	command.baseVertex = mesh.baseVertex;
+	command.baseInstance = (GLuint)commands.size();	// Picks this draw's entry out of the draw ID buffer
+
+	commands.push_back(command);
+	modelMatrices.push_back(modelMatrix);
+}
+
+void IndirectDrawList::submit(GLuint program, GLuint textureUnit, bool multiDraw)
+{
+	if (commands.empty())
+		return;
+
+	reserve((unsigned int)commands.size());
+
+	// Orphan the old storage so the upload does not wait on the previous frame
+	glBindBuffer(GL_TEXTURE_BUFFER, matrixBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, modelMatrices.size() * sizeof(mat4), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, modelMatrices.size() * sizeof(mat4), modelMatrices.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+
+	if (program != programID)
+	{
+		programID = program;
+		modelMatricesID = glGetUniformLocation(programID, "modelMatrices");
+	}
+	glUniform1i(modelMatricesID, textureUnit);
+
+	// One draw ID per instance, offset by each command's base instance
+	glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+	glBindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+	glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+
+	if (multiDraw)
+	{
+		glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0, (void*)0);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*)0, (GLsizei)commands.size(), 0);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else
+	{
+		// GL 3.3 has no base instance, so the attribute pointer itself is moved to the command's entry
+		for (unsigned int i = 0; i < commands.size(); ++i)
+		{
+			const DrawElementsIndirectCommand & command = commands[i];
+
+			glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0, (void*)(command.baseInstance * sizeof(GLuint)));
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_SHORT,
+				(void*)(command.firstIndex * sizeof(unsigned short)), command.instanceCount, command.baseVertex);
+		}
+	}
+
+	glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 0);
+	glDisableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+}
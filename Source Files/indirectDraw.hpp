@@ -0,0 +1,59 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "meshBuffer.hpp"
+
+using namespace glm;
+
+// Layout glMultiDrawElementsIndirect reads from the draw indirect buffer
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Draws out of a MeshBuffer described by an array of indirect commands
+// Each draw's model matrix goes into a texture buffer, and the draw's index reaches the vertex shader through
+// an instanced attribute offset by baseInstance (see indirectVertexShader.glsl).
+// With ARB_multi_draw_indirect the whole array is one call, otherwise the same array is looped over on the CPU.
+class IndirectDrawList
+{
+public:
+	IndirectDrawList();
+	~IndirectDrawList();
+
+	// Creates the buffers, needs a current GL context
+	void init(unsigned int initialCapacity);
+
+	// True if the context can submit the command array in one call, with a baseInstance per command
+	static bool multiDrawSupported();
+
+	void clear();
+	void add(const MeshRecord & mesh, const mat4 & modelMatrix);
+	unsigned int drawCount() const { return (unsigned int)commands.size(); }
+
+	// Uploads the commands and matrices and draws them, on the program and vertex array already bound
+	// The matrices are bound to textureUnit for the program's "modelMatrices" sampler
+	void submit(GLuint program, GLuint textureUnit, bool multiDraw);
+
+private:
+	void reserve(unsigned int draws);
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<mat4> modelMatrices;
+
+	unsigned int capacity;
+
+	GLuint commandBuffer;
+	GLuint drawIDBuffer;	// 0, 1, 2, ... read as the per draw index
+	GLuint matrixBuffer;
+	GLuint matrixTexture;
+
+	GLuint programID;
+	GLint modelMatricesID;
+};
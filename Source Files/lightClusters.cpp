@@ -0,0 +1,342 @@
+#include "lightClusters.hpp"
+
+#include <algorithm>	// For min, max
+#include <chrono>		// For high_resolution_clock
+#include <cmath>		// For log, pow, tan, floor
+
+float lightRadius(float intensity)
+{
+	return sqrt(intensity / LIGHT_CUTOFF);
+}
+
+LightClusterGrid::LightClusterGrid() :
+	poolThreads(0), frameLights(NULL), frame(0), pendingWorkers(0), stopping(false),
+	programID(0), lastBinningMS(0.0), lastMaxLights(0)
+{
+	buffers[0] = buffers[1] = buffers[2] = 0;
+	textures[0] = textures[1] = textures[2] = 0;
+}
+
+LightClusterGrid::~LightClusterGrid()
+{
+	stopWorkers();
+
+	if (buffers[0] != 0)
+	{
+		glDeleteBuffers(3, buffers);
+		glDeleteTextures(3, textures);
+	}
+}
+
+void LightClusterGrid::init()
+{
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+
+	// The texture buffer formats matching the layouts of lightData, clusterData and lightIndices
+	const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+
+	for (int i = 0; i < 3; ++i)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusterGrid::startWorkers(unsigned int threadCount)
+{
+	stopWorkers();
+
+	poolThreads = threadCount;
+	threadIndices.resize(threadCount);
+	threadCounts.resize(threadCount);
+	threadPairs.resize(threadCount);
+	threadOffsets.resize(threadCount);
+
+	for (unsigned int t = 0; t + 1 < threadCount; ++t)
+		workers.push_back(std::thread(&LightClusterGrid::workerLoop, this, t, frame));
+}
+
+void LightClusterGrid::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		stopping = true;
+		workReady.notify_all();
+	}
+
+	for (unsigned int t = 0; t < workers.size(); ++t)
+		workers[t].join();
+
+	workers.clear();
+	stopping = false;
+	poolThreads = 0;
+}
+
+// startFrame is passed in rather than read here, an update could already have moved frame on
+void LightClusterGrid::workerLoop(unsigned int thread, unsigned int startFrame)
+{
+	int firstSlice, lastSlice;
+	sliceRange(thread, firstSlice, lastSlice);
+
+	unsigned int lastFrame = startFrame;
+	for (;;)
+	{
+		const std::vector<PointLight> * lights;
+		{
+			std::unique_lock<std::mutex> lock(workMutex);
+			workReady.wait(lock, [&] { return stopping || frame != lastFrame; });
+
+			if (stopping)
+				return;
+
+			lastFrame = frame;
+			lights = frameLights;
+		}
+
+		binSlices(*lights, firstSlice, lastSlice, thread);
+
+		std::lock_guard<std::mutex> lock(workMutex);
+		if (--pendingWorkers == 0)
+			workDone.notify_one();
+	}
+}
+
+// Each thread owns a contiguous range of depth slices, so no cluster is written by two threads
+// and the result does not depend on the thread count
+void LightClusterGrid::sliceRange(unsigned int thread, int & firstSlice, int & lastSlice) const
+{
+	firstSlice = CLUSTERS_Z * thread / poolThreads;
+	lastSlice = CLUSTERS_Z * (thread + 1) / poolThreads;
+}
+
+void LightClusterGrid::update(const std::vector<PointLight> & lights, const mat4 & view, float fovY, float aspect, float zNear, float zFar, unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, (unsigned int)CLUSTERS_Z);
+
+	// Starting threads is not part of the binning, only done when the thread count changes
+	if (threadCount != poolThreads)
+		startWorkers(threadCount);
+
+	auto begin = std::chrono::high_resolution_clock::now();
+
+	viewMatrix = view;
+	tanHalfY = tan(fovY * 0.5f);
+	tanHalfX = tanHalfY * aspect;
+
+	// Exponential slices keep clusters roughly cubic, near slices are thin and far ones deep
+	logNear = log(zNear);
+	logDepthRange = log(zFar / zNear);
+	for (int k = 0; k <= CLUSTERS_Z; ++k)
+		sliceDepths[k] = zNear * pow(zFar / zNear, (float)k / CLUSTERS_Z);
+
+	// Lights go to the shader in camera space, same space the lighting is done in
+	lightData.resize(lights.size() * 2);
+	for (unsigned int i = 0; i < lights.size(); ++i)
+	{
+		vec4 position_cameraSpace = viewMatrix * vec4(lights[i].position, 1.0f);
+		lightData[2 * i]		= vec4(position_cameraSpace.x, position_cameraSpace.y, position_cameraSpace.z, lights[i].radius);
+		lightData[2 * i + 1]	= vec4(lights[i].color * lights[i].intensity, lights[i].intensity);
+	}
+
+	// Wake the workers, bin the last range here, then wait for the others
+	if (!workers.empty())
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		frameLights = &lights;
+		pendingWorkers = (unsigned int)workers.size();
+		++frame;
+		workReady.notify_all();
+	}
+
+	int firstSlice, lastSlice;
+	sliceRange(threadCount - 1, firstSlice, lastSlice);
+	binSlices(lights, firstSlice, lastSlice, threadCount - 1);
+
+	if (!workers.empty())
+	{
+		std::unique_lock<std::mutex> lock(workMutex);
+		workDone.wait(lock, [this] { return pendingWorkers == 0; });
+	}
+
+	// Thread outputs are already ordered by cluster, concatenate them in slice order
+	clusterData.resize(CLUSTER_COUNT * 2);
+	lightIndices.clear();
+	lastMaxLights = 0;
+
+	unsigned int cluster = 0;
+	unsigned int offset = 0;
+	for (unsigned int t = 0; t < threadCount; ++t)
+	{
+		for (unsigned int i = 0; i < threadCounts[t].size(); ++i, ++cluster)
+		{
+			clusterData[2 * cluster]		= offset;
+			clusterData[2 * cluster + 1]	= threadCounts[t][i];
+			offset += threadCounts[t][i];
+			lastMaxLights = std::max(lastMaxLights, threadCounts[t][i]);
+		}
+
+		lightIndices.insert(lightIndices.end(), threadIndices[t].begin(), threadIndices[t].end());
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	lastBinningMS = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.0;
+}
+
+// Tile coordinate of a camera space x (or y) at depth d, in [0, tiles) when on screen
+static float tileCoordinate(float x, float d, float tanHalf, int tiles)
+{
+	return (x / (d * tanHalf) + 1.0f) * 0.5f * tiles;
+}
+
+void LightClusterGrid::binSlices(const std::vector<PointLight> & lights, int firstSlice, int lastSlice, unsigned int thread)
+{
+	const int SLICE_SIZE = CLUSTERS_X * CLUSTERS_Y;
+
+	std::vector<unsigned int> & out_indices = threadIndices[thread];
+	std::vector<unsigned int> & out_counts = threadCounts[thread];
+
+	// (local cluster, light) pairs in light order
+	std::vector<unsigned int> & pairs = threadPairs[thread];
+	pairs.clear();
+	out_counts.assign((lastSlice - firstSlice) * SLICE_SIZE, 0);
+
+	for (unsigned int l = 0; l < lights.size(); ++l)
+	{
+		vec3 p(lightData[2 * l].x, lightData[2 * l].y, lightData[2 * l].z);
+		float r = lightData[2 * l].w;
+
+		// Camera looks down -z, depth is positive in front of it
+		float depth = -p.z;
+		float nearest = depth - r;
+		float farthest = depth + r;
+
+		if (farthest <= sliceDepths[firstSlice] || nearest >= sliceDepths[lastSlice])
+			continue;
+
+		int k0 = nearest <= sliceDepths[0] ? 0 : (int)floor((log(nearest) - logNear) / logDepthRange * CLUSTERS_Z);
+		int k1 = (int)floor((log(farthest) - logNear) / logDepthRange * CLUSTERS_Z);
+		k0 = std::max(k0, firstSlice);
+		k1 = std::min(k1, lastSlice - 1);
+
+		for (int k = k0; k <= k1; ++k)
+		{
+			float d0 = sliceDepths[k];
+			float d1 = sliceDepths[k + 1];
+
+			// Conservative tile range of the sphere's bounding box over the depth range of the slice
+			float xMin = p.x - r, xMax = p.x + r;
+			float yMin = p.y - r, yMax = p.y + r;
+			float uMin = tileCoordinate(xMin, xMin < 0.0f ? d0 : d1, tanHalfX, CLUSTERS_X);
+			float uMax = tileCoordinate(xMax, xMax > 0.0f ? d0 : d1, tanHalfX, CLUSTERS_X);
+			float vMin = tileCoordinate(yMin, yMin < 0.0f ? d0 : d1, tanHalfY, CLUSTERS_Y);
+			float vMax = tileCoordinate(yMax, yMax > 0.0f ? d0 : d1, tanHalfY, CLUSTERS_Y);
+
+			if (uMax < 0.0f || uMin >= CLUSTERS_X || vMax < 0.0f || vMin >= CLUSTERS_Y)
+				continue;
+
+			int i0 = std::max(0, (int)floor(uMin)), i1 = std::min(CLUSTERS_X - 1, (int)floor(uMax));
+			int j0 = std::max(0, (int)floor(vMin)), j1 = std::min(CLUSTERS_Y - 1, (int)floor(vMax));
+
+			for (int j = j0; j <= j1; ++j)
+			{
+				float yBottom	= (-1.0f + 2.0f * j / CLUSTERS_Y) * tanHalfY;
+				float yTop		= (-1.0f + 2.0f * (j + 1) / CLUSTERS_Y) * tanHalfY;
+
+				for (int i = i0; i <= i1; ++i)
+				{
+					float xLeft		= (-1.0f + 2.0f * i / CLUSTERS_X) * tanHalfX;
+					float xRight	= (-1.0f + 2.0f * (i + 1) / CLUSTERS_X) * tanHalfX;
+
+					// Bounding box of the cluster's frustum piece
+					vec3 boxMin(std::min(xLeft * d0, xLeft * d1), std::min(yBottom * d0, yBottom * d1), -d1);
+					vec3 boxMax(std::max(xRight * d0, xRight * d1), std::max(yTop * d0, yTop * d1), -d0);
+
+					// Sphere against box, squared distance from the center to the closest point
+					vec3 closest = clamp(p, boxMin, boxMax);
+					vec3 offset = p - closest;
+
+					if (dot(offset, offset) <= r * r)
+					{
+						unsigned int local = (k - firstSlice) * SLICE_SIZE + j * CLUSTERS_X + i;
+						pairs.push_back(local);
+						pairs.push_back(l);
+						++out_counts[local];
+					}
+				}
+			}
+		}
+	}
+
+	// Counting sort by cluster, stable so each list stays in light order
+	// Both buffers keep their capacity, so nothing is allocated once the light counts settle
+	std::vector<unsigned int> & offsets = threadOffsets[thread];
+	offsets.assign(out_counts.size() + 1, 0);
+	for (unsigned int c = 0; c < out_counts.size(); ++c)
+		offsets[c + 1] = offsets[c] + out_counts[c];
+
+	out_indices.resize(offsets.back());
+	for (unsigned int i = 0; i < pairs.size(); i += 2)
+		out_indices[offsets[pairs[i]]++] = pairs[i + 1];
+}
+
+void LightClusterGrid::bind(GLuint program, GLuint firstTextureUnit, int viewportWidth, int viewportHeight)
+{
+	// Texture buffers can not be empty, upload a dummy element instead, the statistics still see the real lists
+	static const vec4 emptyLightData[2] = { vec4(0.0f), vec4(0.0f) };
+	static const unsigned int emptyLightIndices[1] = { 0 };
+
+	const void * data[3] = {
+		lightData.empty() ? (const void *)emptyLightData : (const void *)&lightData[0],
+		&clusterData[0],
+		lightIndices.empty() ? (const void *)emptyLightIndices : (const void *)&lightIndices[0]
+	};
+	const size_t sizes[3] = {
+		lightData.empty() ? sizeof(emptyLightData) : lightData.size() * sizeof(vec4),
+		clusterData.size() * sizeof(unsigned int),
+		lightIndices.empty() ? sizeof(emptyLightIndices) : lightIndices.size() * sizeof(unsigned int)
+	};
+
+	for (int i = 0; i < 3; ++i)
+	{
+		// Orphan the old storage so the upload does not wait on the previous frame
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, sizes[i], NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]);
+
+		glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// Uniform locations are only looked up again when the program changes
+	if (program != programID)
+	{
+		programID = program;
+		lightDataID =		glGetUniformLocation(programID, "lightData");
+		clusterDataID =		glGetUniformLocation(programID, "clusterData");
+		lightIndicesID =	glGetUniformLocation(programID, "lightIndices");
+		clusterDimsID =		glGetUniformLocation(programID, "clusterDims");
+		clusterDepthID =	glGetUniformLocation(programID, "clusterDepthScaleBias");
+		screenSizeID =		glGetUniformLocation(programID, "screenSize");
+	}
+
+	glUniform1i(lightDataID, firstTextureUnit);
+	glUniform1i(clusterDataID, firstTextureUnit + 1);
+	glUniform1i(lightIndicesID, firstTextureUnit + 2);
+	glUniform3i(clusterDimsID, CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+
+	// slice = log(depth) * scale + bias
+	float depthScale = CLUSTERS_Z / logDepthRange;
+	glUniform2f(clusterDepthID, depthScale, -logNear * depthScale);
+	glUniform2f(screenSizeID, (float)viewportWidth, (float)viewportHeight);
+}
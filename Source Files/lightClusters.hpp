@@ -0,0 +1,109 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace glm;
+
+// Point light with a finite range so it can be assigned to clusters
+struct PointLight
+{
+	vec3 position;		// In world space
+	float radius;		// Distance past which the light contributes nothing
+	vec3 color;			// In RGB
+	float intensity;	// In watts
+};
+
+// Light intensity at the edge of a light's range, anything dimmer is cut off
+const float LIGHT_CUTOFF = 0.05f;
+
+// Radius at which intensity / distance^2 falls to LIGHT_CUTOFF
+float lightRadius(float intensity);
+
+// Clustered forward lighting
+// The view frustum is split into CLUSTERS_X * CLUSTERS_Y screen tiles and CLUSTERS_Z exponential depth slices.
+// Lights are binned into clusters on the CPU every frame and the per-cluster light lists are uploaded
+// in texture buffers, so the fragment shader only loops over the lights that can reach its cluster.
+class LightClusterGrid
+{
+public:
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 12;
+	static const int CLUSTERS_Z = 24;
+	static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+	LightClusterGrid();
+	~LightClusterGrid();
+
+	// Creates the texture buffers, needs a current GL context
+	void init();
+
+	// Bins the lights into clusters for this camera, threadCount of 0 uses every hardware thread
+	// The worker threads are started on the first update and kept until the grid is destroyed, or a different threadCount is asked for
+	void update(const std::vector<PointLight> & lights, const mat4 & view, float fovY, float aspect, float zNear, float zFar, unsigned int threadCount = 0);
+
+	// Uploads the light data and cluster lists and binds them to three texture units starting at firstTextureUnit
+	void bind(GLuint program, GLuint firstTextureUnit, int viewportWidth, int viewportHeight);
+
+	// Statistics of the last update
+	double binningMS() const { return lastBinningMS; }
+	float averageLightsPerCluster() const { return (float)lightIndices.size() / CLUSTER_COUNT; }
+	unsigned int maxLightsPerCluster() const { return lastMaxLights; }
+
+private:
+	// Bins slices [firstSlice, lastSlice) into the given thread's buffers
+	void binSlices(const std::vector<PointLight> & lights, int firstSlice, int lastSlice, unsigned int thread);
+
+	// Worker threads bin slices for every thread but the last, which is the caller
+	void startWorkers(unsigned int threadCount);
+	void stopWorkers();
+	void workerLoop(unsigned int thread, unsigned int startFrame);
+	void sliceRange(unsigned int thread, int & firstSlice, int & lastSlice) const;
+
+	// Per frame camera data used by the binning
+	mat4 viewMatrix;
+	float tanHalfX, tanHalfY;
+	float sliceDepths[CLUSTERS_Z + 1];
+	float logNear, logDepthRange;
+
+	// Light data in view space, two RGBA32F texels per light: position + radius, color * intensity
+	std::vector<vec4> lightData;
+
+	// Offset and count into lightIndices per cluster, in RG32UI
+	std::vector<unsigned int> clusterData;
+
+	// Concatenated light lists of every cluster, in R32UI
+	std::vector<unsigned int> lightIndices;
+
+	// Per thread light lists and counts of the slices it binned, reused between frames
+	std::vector<std::vector<unsigned int>> threadIndices;
+	std::vector<std::vector<unsigned int>> threadCounts;
+
+	// Per thread sort scratch, (cluster, light) pairs before sorting and each cluster's write offset
+	std::vector<std::vector<unsigned int>> threadPairs;
+	std::vector<std::vector<unsigned int>> threadOffsets;
+
+	// Workers wait on workReady until frame changes, the caller waits on workDone until pendingWorkers is 0
+	std::vector<std::thread> workers;
+	unsigned int poolThreads;					// Workers + the calling thread, 0 before the first update
+	const std::vector<PointLight> * frameLights;
+	unsigned int frame;
+	unsigned int pendingWorkers;
+	bool stopping;
+	std::mutex workMutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+
+	GLuint buffers[3];
+	GLuint textures[3];
+
+	// Uniform locations in the last program bound
+	GLuint programID;
+	GLint lightDataID, clusterDataID, lightIndicesID, clusterDimsID, clusterDepthID, screenSizeID;
+
+	double lastBinningMS;
+	unsigned int lastMaxLights;
+};
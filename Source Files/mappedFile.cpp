@@ -0,0 +1,150 @@
+#include "mappedFile.hpp"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : bytes(NULL), fileSize(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL)
+{
+}
+
+bool MappedFile::open(const char * path)
+{
+	close();
+
+	fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		printf("Could not open %s\n", path);
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0)
+	{
+		printf("%s is empty\n", path);
+		close();
+		return false;
+	}
+	fileSize = size.QuadPart;
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle != NULL)
+		bytes = (const unsigned char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (bytes == NULL)
+	{
+		printf("Could not map %s\n", path);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (bytes != NULL)
+		UnmapViewOfFile(bytes);
+	if (mappingHandle != NULL)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	bytes = NULL;
+	fileSize = 0;
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+
+void MappedFile::release(unsigned long long offset, unsigned long long length)
+{
+	// Unlocking pages that are not locked takes them out of the working set
+	if (bytes != NULL && offset < fileSize)
+		VirtualUnlock((void*)(bytes + offset), (SIZE_T)(offset + length > fileSize ? fileSize - offset : length));
+}
+
+#else
+
+MappedFile::MappedFile() : bytes(NULL), fileSize(0), fileDescriptor(-1)
+{
+}
+
+bool MappedFile::open(const char * path)
+{
+	close();
+
+	fileDescriptor = ::open(path, O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		printf("Could not open %s\n", path);
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0)
+	{
+		printf("%s is empty\n", path);
+		close();
+		return false;
+	}
+	fileSize = info.st_size;
+
+	void * mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		printf("Could not map %s\n", path);
+		close();
+		return false;
+	}
+
+	// Meshlets are read in whatever order the camera asks for, read ahead would only waste memory
+	madvise(mapping, fileSize, MADV_RANDOM);
+	bytes = (const unsigned char *)mapping;
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (bytes != NULL)
+		munmap((void*)bytes, fileSize);
+	if (fileDescriptor >= 0)
+		::close(fileDescriptor);
+
+	bytes = NULL;
+	fileSize = 0;
+	fileDescriptor = -1;
+}
+
+void MappedFile::release(unsigned long long offset, unsigned long long length)
+{
+	if (bytes == NULL || offset >= fileSize)
+		return;
+
+	// madvise works on whole pages, only drop the ones entirely inside the range
+	unsigned long long pageSize = sysconf(_SC_PAGESIZE);
+	unsigned long long end = offset + length > fileSize ? fileSize : offset + length;
+	unsigned long long first = (offset + pageSize - 1) / pageSize * pageSize;
+	unsigned long long last = end / pageSize * pageSize;
+
+	if (last > first)
+		madvise((void*)(bytes + first), last - first, MADV_DONTNEED);
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+
+// Read only memory mapping of a whole file
+// Pages are only read from disk when touched, so a file larger than memory can be read a piece at a time.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const char * path);
+	void close();
+
+	const unsigned char * data() const { return bytes; }
+	unsigned long long size() const { return fileSize; }
+
+	// Tells the OS a range will not be read again soon so its pages can be dropped first
+	void release(unsigned long long offset, unsigned long long length);
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	const unsigned char * bytes;
+	unsigned long long fileSize;
+
+#ifdef _WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
@@ -0,0 +1,92 @@
+#include "meshBuffer.hpp"
+
+MeshBuffer::MeshBuffer() : vertexBuffer(0), UVBuffer(0), normalBuffer(0), elementBuffer(0)
+{
+}
+
+MeshBuffer::~MeshBuffer()
+{
+	if (vertexBuffer != 0)
+	{
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &UVBuffer);
+		glDeleteBuffers(1, &normalBuffer);
+		glDeleteBuffers(1, &elementBuffer);
+	}
+}
+
+unsigned int MeshBuffer::addMesh(
+	const std::vector<unsigned short> & indices,
+	const std::vector<vec3> & vertices,
+	const std::vector<vec2> & uvs,
+	const std::vector<vec3> & normals
+){
+	MeshRecord record;
+	record.firstIndex = (GLuint)allIndices.size();
+	record.indexCount = (GLuint)indices.size();
+	record.baseVertex = (GLint)allVertices.size();
+	record.boundsMin = vertices.empty() ? vec3(0.0f) : vertices[0];
+	record.boundsMax = record.boundsMin;
+
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		record.boundsMin = min(record.boundsMin, vertices[i]);
+		record.boundsMax = max(record.boundsMax, vertices[i]);
+	}
+
+	allIndices.insert(allIndices.end(), indices.begin(), indices.end());
+	allVertices.insert(allVertices.end(), vertices.begin(), vertices.end());
+	allUVs.insert(allUVs.end(), uvs.begin(), uvs.end());
+	allNormals.insert(allNormals.end(), normals.begin(), normals.end());
+
+	meshes.push_back(record);
+	return (unsigned int)meshes.size() - 1;
+}
+
+void MeshBuffer::upload()
+{
+	// Generates a buffer and puts resulting ID in buffer ID's
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, allVertices.size() * sizeof(vec3), allVertices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &UVBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, UVBuffer);
+	glBufferData(GL_ARRAY_BUFFER, allUVs.size() * sizeof(vec2), allUVs.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &normalBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+	glBufferData(GL_ARRAY_BUFFER, allNormals.size() * sizeof(vec3), allNormals.data(), GL_STATIC_DRAW);
+
+	// Element buffer for VBO indexing
+	glGenBuffers(1, &elementBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned short), allIndices.data(), GL_STATIC_DRAW);
+
+	// The GPU has its copy now
+	std::vector<unsigned short>().swap(allIndices);
+	std::vector<vec3>().swap(allVertices);
+	std::vector<vec2>().swap(allUVs);
+	std::vector<vec3>().swap(allNormals);
+}
+
+void MeshBuffer::bindAttributes() const
+{
+	// Attribute for vertex buffer
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	// Attribute for UV buffer
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, UVBuffer);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	// Attribute for normal buffer
+	glEnableVertexAttribArray(2);
+	glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	// Index buffer
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+}
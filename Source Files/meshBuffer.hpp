@@ -0,0 +1,55 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace glm;
+
+// Where one mesh lives in the shared buffers
+struct MeshRecord
+{
+	GLuint firstIndex;	// Offset into the index buffer, in indices
+	GLuint indexCount;
+	GLint baseVertex;	// Added to every index, so meshes keep their own 16 bit indices
+	vec3 boundsMin;		// Model space bounds
+	vec3 boundsMax;
+};
+
+// Every mesh packed into one vertex buffer per attribute and one index buffer
+// so any mesh can be drawn without rebinding, and a single indirect draw can cover all of them
+class MeshBuffer
+{
+public:
+	MeshBuffer();
+	~MeshBuffer();
+
+	// Appends an indexed mesh, as produced by indexVBO, and returns its record index
+	unsigned int addMesh(
+		const std::vector<unsigned short> & indices,
+		const std::vector<vec3> & vertices,
+		const std::vector<vec2> & uvs,
+		const std::vector<vec3> & normals
+	);
+
+	// Creates the GL buffers from everything added, the CPU copies are released
+	void upload();
+
+	// Points attributes 0 to 2 and the element array at the shared buffers
+	void bindAttributes() const;
+
+	const MeshRecord & mesh(unsigned int index) const { return meshes[index]; }
+	unsigned int meshCount() const { return (unsigned int)meshes.size(); }
+
+private:
+	std::vector<MeshRecord> meshes;
+
+	std::vector<unsigned short> allIndices;
+	std::vector<vec3> allVertices;
+	std::vector<vec2> allUVs;
+	std::vector<vec3> allNormals;
+
+	GLuint vertexBuffer;
+	GLuint UVBuffer;
+	GLuint normalBuffer;
+	GLuint elementBuffer;
+};
@@ -0,0 +1,204 @@
+#include "meshOptimizer.hpp"
+
+// Next vertex to fan around: the candidate that will still be in the cache after its remaining triangles, oldest first
+static int getNextVertex(
+	const std::vector<int> & candidates,
+	const std::vector<unsigned int> & cacheTime,
+	const std::vector<unsigned int> & liveTriangles,
+	std::vector<int> & deadEnd,
+	unsigned int & cursor,
+	unsigned int timeStamp,
+	unsigned int cacheSize
+){
+	int best = -1;
+	int bestPriority = -1;
+
+	for (unsigned int i = 0; i < candidates.size(); ++i)
+	{
+		int v = candidates[i];
+		if (liveTriangles[v] == 0)
+			continue;
+
+		// Vertices that would be evicted before their triangles are done get the lowest priority
+		int priority = 0;
+		if (timeStamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+			priority = timeStamp - cacheTime[v];
+
+		if (priority > bestPriority)
+		{
+			bestPriority = priority;
+			best = v;
+		}
+	}
+
+	if (best != -1)
+		return best;
+
+	// No candidate left, go back to recently used vertices that still have triangles
+	while (!deadEnd.empty())
+	{
+		int v = deadEnd.back();
+		deadEnd.pop_back();
+		if (liveTriangles[v] > 0)
+			return v;
+	}
+
+	// Then to the next vertex in input order
+	while (cursor < liveTriangles.size())
+	{
+		if (liveTriangles[cursor] > 0)
+			return cursor;
+		++cursor;
+	}
+
+	return -1;
+}
+
+template <typename IndexType>
+static void optimizeVertexCacheImpl(std::vector<IndexType> & indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	unsigned int triangleCount = (unsigned int)indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// Triangles using each vertex, as offsets into one list
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; ++i)
+		++liveTriangles[indices[i]];
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (unsigned int i = 0; i < triangleCount * 3; ++i)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<int> deadEnd;
+	std::vector<int> candidates;
+
+	std::vector<IndexType> output;
+	output.reserve(triangleCount * 3);
+
+	unsigned int timeStamp = cacheSize + 1;
+	unsigned int cursor = 1;
+	int fanning = 0;
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex
+		for (unsigned int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a)
+		{
+			unsigned int t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				IndexType v = indices[t * 3 + corner];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--liveTriangles[v];
+
+				// Not in the cache any more, this is a new transform
+				if (timeStamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timeStamp++;
+			}
+
+			emitted[t] = true;
+		}
+
+		fanning = getNextVertex(candidates, cacheTime, liveTriangles, deadEnd, cursor, timeStamp, cacheSize);
+	}
+
+	indices.swap(output);
+}
+
+void optimizeVertexCache(std::vector<unsigned short> & indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	optimizeVertexCacheImpl(indices, vertexCount, cacheSize);
+}
+
+void optimizeVertexCache(std::vector<unsigned int> & indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	optimizeVertexCacheImpl(indices, vertexCount, cacheSize);
+}
+
+void optimizeVertexFetch(
+	std::vector<unsigned short> & indices,
+	std::vector<vec3> & vertices,
+	std::vector<vec2> & uvs,
+	std::vector<vec3> & normals,
+	std::vector<vec3> * tangents,
+	std::vector<vec3> * bitangents
+){
+	const unsigned int UNUSED = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertices.size(), UNUSED);
+
+	std::vector<vec3> out_vertices;
+	std::vector<vec2> out_uvs;
+	std::vector<vec3> out_normals;
+	std::vector<vec3> out_tangents;
+	std::vector<vec3> out_bitangents;
+	out_vertices.reserve(vertices.size());
+	out_uvs.reserve(uvs.size());
+	out_normals.reserve(normals.size());
+
+	for (unsigned int i = 0; i < indices.size(); ++i)
+	{
+		unsigned short v = indices[i];
+		if (remap[v] == UNUSED)
+		{
+			remap[v] = (unsigned int)out_vertices.size();
+			out_vertices.push_back(vertices[v]);
+			out_uvs.push_back(uvs[v]);
+			out_normals.push_back(normals[v]);
+
+			if (tangents != NULL)
+				out_tangents.push_back((*tangents)[v]);
+			if (bitangents != NULL)
+				out_bitangents.push_back((*bitangents)[v]);
+		}
+
+		indices[i] = (unsigned short)remap[v];
+	}
+
+	vertices.swap(out_vertices);
+	uvs.swap(out_uvs);
+	normals.swap(out_normals);
+
+	if (tangents != NULL)
+		tangents->swap(out_tangents);
+	if (bitangents != NULL)
+		bitangents->swap(out_bitangents);
+}
+
+float averageCacheMissRatio(const std::vector<unsigned short> & indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	if (indices.size() < 3)
+		return 0.0f;
+
+	// Time each vertex entered the FIFO, it is still in it while fewer than cacheSize misses happened since
+	std::vector<unsigned int> enteredAt(vertexCount, 0);
+	std::vector<bool> seen(vertexCount, false);
+	unsigned int misses = 0;
+
+	for (unsigned int i = 0; i < indices.size(); ++i)
+	{
+		unsigned short v = indices[i];
+		if (!seen[v] || misses - enteredAt[v] >= cacheSize)
+		{
+			seen[v] = true;
+			enteredAt[v] = misses;
+			++misses;
+		}
+	}
+
+	return (float)misses / (indices.size() / 3);
+}
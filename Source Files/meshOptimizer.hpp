@@ -0,0 +1,27 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace glm;
+
+// Post transform cache size the optimizer and the miss ratio assume
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// Reorders triangles so vertices are reused while still in the post transform cache
+// Tipsify (Sander, Nehab, Barczak 2007), linear in the triangle count
+void optimizeVertexCache(std::vector<unsigned short> & indices, unsigned int vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+void optimizeVertexCache(std::vector<unsigned int> & indices, unsigned int vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders vertices by first use in the index buffer so fetches walk memory forward
+// Vertices no triangle uses are dropped, tangents and bitangents are reordered along when given
+void optimizeVertexFetch(
+	std::vector<unsigned short> & indices,
+	std::vector<vec3> & vertices,
+	std::vector<vec2> & uvs,
+	std::vector<vec3> & normals,
+	std::vector<vec3> * tangents = NULL,
+	std::vector<vec3> * bitangents = NULL
+);
+
+// Average vertices transformed per triangle for a FIFO cache, 3 is no reuse at all, 0.5 is the best a regular grid gets
+float averageCacheMissRatio(const std::vector<unsigned short> & indices, unsigned int vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
@@ -0,0 +1,153 @@
+#include "meshletBuilder.hpp"
+
+#include <algorithm>	// For max, min
+#include <cmath>		// For sqrt
+
+// Bounds and normal cone of a finished meshlet
+static void computeMeshletBounds(
+	Meshlet & meshlet,
+	const std::vector<vec3> & positions,
+	const std::vector<unsigned int> & meshletVertices,
+	const std::vector<unsigned char> & meshletTriangles
+){
+	const unsigned int * vertices = &meshletVertices[meshlet.vertexOffset];
+	const unsigned char * triangles = &meshletTriangles[meshlet.triangleOffset * 3];
+
+	// Sphere around the box center, loose but cheap
+	vec3 boxMin = positions[vertices[0]];
+	vec3 boxMax = boxMin;
+	for (unsigned int i = 1; i < meshlet.vertexCount; ++i)
+	{
+		boxMin = min(boxMin, positions[vertices[i]]);
+		boxMax = max(boxMax, positions[vertices[i]]);
+	}
+
+	meshlet.center = (boxMin + boxMax) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (unsigned int i = 0; i < meshlet.vertexCount; ++i)
+		meshlet.radius = std::max(meshlet.radius, length(positions[vertices[i]] - meshlet.center));
+
+	// Cone axis is the average face normal, degenerate triangles have no say
+	std::vector<vec3> normals(meshlet.triangleCount, vec3(0.0f));
+	vec3 axis(0.0f);
+	for (unsigned int t = 0; t < meshlet.triangleCount; ++t)
+	{
+		vec3 p0 = positions[vertices[triangles[t * 3 + 0]]];
+		vec3 p1 = positions[vertices[triangles[t * 3 + 1]]];
+		vec3 p2 = positions[vertices[triangles[t * 3 + 2]]];
+
+		vec3 normal = cross(p1 - p0, p2 - p0);
+		float area = length(normal);
+		if (area > 0.0f)
+			normals[t] = normal / area;
+
+		axis += normals[t];
+	}
+
+	meshlet.coneApex = meshlet.center;
+	meshlet.coneAxis = vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = MESHLET_CONE_DISABLED;
+
+	float axisLength = length(axis);
+	if (axisLength <= 0.0f)
+		return;
+	axis /= axisLength;
+
+	// Widest angle between the axis and a triangle normal
+	float minimumDot = 1.0f;
+	for (unsigned int t = 0; t < meshlet.triangleCount; ++t)
+	{
+		if (normals[t] != vec3(0.0f))
+			minimumDot = std::min(minimumDot, dot(axis, normals[t]));
+	}
+
+	// Past about 84 degrees the cone would hardly ever cull and the apex runs off to infinity
+	if (minimumDot <= 0.1f)
+	{
+		meshlet.coneAxis = axis;
+		return;
+	}
+
+	// Apex far enough back along the axis that every triangle's plane is in front of it
+	float apexDistance = 0.0f;
+	for (unsigned int t = 0; t < meshlet.triangleCount; ++t)
+	{
+		if (normals[t] == vec3(0.0f))
+			continue;
+
+		vec3 p0 = positions[vertices[triangles[t * 3 + 0]]];
+		float distance = dot(meshlet.center - p0, normals[t]) / dot(axis, normals[t]);
+		apexDistance = std::max(apexDistance, distance);
+	}
+
+	meshlet.coneApex = meshlet.center - axis * apexDistance;
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = sqrt(1.0f - minimumDot * minimumDot);
+}
+
+void buildMeshlets(
+	const std::vector<unsigned int> & indices,
+	const std::vector<vec3> & positions,
+	std::vector<Meshlet> & out_meshlets,
+	std::vector<unsigned int> & out_vertices,
+	std::vector<unsigned char> & out_triangles
+){
+	const unsigned char NOT_IN_MESHLET = 0xFF;
+
+	// Local index of each mesh vertex in the meshlet being filled
+	std::vector<unsigned char> localIndex(positions.size(), NOT_IN_MESHLET);
+
+	Meshlet current;
+	current.vertexOffset = (unsigned int)out_vertices.size();
+	current.vertexCount = 0;
+	current.triangleOffset = (unsigned int)out_triangles.size() / 3;
+	current.triangleCount = 0;
+
+	for (unsigned int i = 0; i + 2 < indices.size(); i += 3)
+	{
+		// Vertices this triangle would add
+		unsigned int added = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int v = indices[i + corner];
+			bool repeated = (corner > 0 && indices[i] == v) || (corner > 1 && indices[i + 1] == v);
+			if (localIndex[v] == NOT_IN_MESHLET && !repeated)
+				++added;
+		}
+
+		// Full, start the next one
+		if (current.vertexCount + added > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+		{
+			for (unsigned int v = 0; v < current.vertexCount; ++v)
+				localIndex[out_vertices[current.vertexOffset + v]] = NOT_IN_MESHLET;
+
+			computeMeshletBounds(current, positions, out_vertices, out_triangles);
+			out_meshlets.push_back(current);
+
+			current.vertexOffset = (unsigned int)out_vertices.size();
+			current.vertexCount = 0;
+			current.triangleOffset = (unsigned int)out_triangles.size() / 3;
+			current.triangleCount = 0;
+		}
+
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int v = indices[i + corner];
+			if (localIndex[v] == NOT_IN_MESHLET)
+			{
+				localIndex[v] = (unsigned char)current.vertexCount++;
+				out_vertices.push_back(v);
+			}
+
+			out_triangles.push_back(localIndex[v]);
+		}
+
+		++current.triangleCount;
+	}
+
+	if (current.triangleCount > 0)
+	{
+		computeMeshletBounds(current, positions, out_vertices, out_triangles);
+		out_meshlets.push_back(current);
+	}
+}
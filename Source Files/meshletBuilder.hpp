@@ -0,0 +1,42 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace glm;
+
+// Limits per meshlet, 64 vertices keeps local indices in a byte and 124 triangles fills the rest of a 128 entry block
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// Cone cutoff of meshlets whose triangles spread too far for the cone to cull anything
+// Above 1 so no dot product can reach it, culling code skips the test for any cutoff >= 1
+const float MESHLET_CONE_DISABLED = 2.0f;
+
+// A small piece of a mesh that is culled and streamed on its own
+struct Meshlet
+{
+	unsigned int vertexOffset;		// Into the meshlet vertex list
+	unsigned int vertexCount;
+	unsigned int triangleOffset;	// Into the meshlet triangle list, in triangles
+	unsigned int triangleCount;
+
+	// Bounding sphere
+	vec3 center;
+	float radius;
+
+	// Normal cone, every triangle faces away from cameras where dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+	// A cutoff of MESHLET_CONE_DISABLED means the cone never culls, real cutoffs are always below 1
+	vec3 coneApex;
+	vec3 coneAxis;
+	float coneCutoff;
+};
+
+// Splits an indexed mesh into meshlets in index order, run optimizeVertexCache first for tighter meshlets
+// out_vertices maps each meshlet's local vertices to mesh vertices, out_triangles holds 3 local indices per triangle
+void buildMeshlets(
+	const std::vector<unsigned int> & indices,
+	const std::vector<vec3> & positions,
+	std::vector<Meshlet> & out_meshlets,
+	std::vector<unsigned int> & out_vertices,
+	std::vector<unsigned char> & out_triangles
+);
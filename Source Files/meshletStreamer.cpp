@@ -0,0 +1,326 @@
+#include "meshletStreamer.hpp"
+
+#include <stdio.h>
+#include <float.h>		// For FLT_MAX
+#include <algorithm>	// For sort
+#include <cmath>		// For tan, sqrt
+#include <utility>		// For pair
+
+// Every slot has room for the largest meshlet, indices are widened to 16 bits on upload
+const unsigned int SLOT_VERTEX_BYTES = MESHLET_MAX_VERTICES * sizeof(MeshletVertex);
+const unsigned int SLOT_INDEX_COUNT = MESHLET_MAX_TRIANGLES * 3;
+
+MeshletStreamer::MeshletStreamer() :
+	header(NULL), table(NULL), slotCount(0), slotBytes(SLOT_VERTEX_BYTES + SLOT_INDEX_COUNT * sizeof(unsigned short)), residentMeshlets(0),
+	frame(0), vertexBuffer(0), indexBuffer(0),
+	lastVisible(0), lastFrustumCulled(0), lastConeCulled(0), lastMissing(0), lastPagedIn(0), lastEvicted(0)
+{
+}
+
+MeshletStreamer::~MeshletStreamer()
+{
+	if (vertexBuffer != 0)
+	{
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+}
+
+bool MeshletStreamer::open(const char * path, unsigned long long residentBudget)
+{
+	if (!file.open(path))
+		return false;
+
+	// Check everything the table points at is inside the file before trusting it
+	if (file.size() < sizeof(MeshletCacheHeader))
+	{
+		printf("%s is too small to be a meshlet cache\n", path);
+		return false;
+	}
+
+	header = (const MeshletCacheHeader *)file.data();
+	if (header->magic != MESHLET_CACHE_MAGIC || header->version != ASSET_CACHE_VERSION ||
+		header->vertexStride != sizeof(MeshletVertex) || header->maxVertices > MESHLET_MAX_VERTICES || header->maxTriangles > MESHLET_MAX_TRIANGLES)
+	{
+		printf("%s is not a meshlet cache, or from another version\n", path);
+		header = NULL;
+		return false;
+	}
+
+	if (header->tableOffset > file.size() || (file.size() - header->tableOffset) / sizeof(MeshletCacheEntry) < header->meshletCount)
+	{
+		printf("Meshlet cache %s is truncated\n", path);
+		header = NULL;
+		return false;
+	}
+
+	table = (const MeshletCacheEntry *)(file.data() + header->tableOffset);
+
+	slotCount = (unsigned int)std::min<unsigned long long>(residentBudget / slotBytes, header->meshletCount);
+	if (slotCount == 0)
+	{
+		printf("Resident budget is too small for a single meshlet\n");
+		header = NULL;
+		return false;
+	}
+
+	meshletSlots.assign(header->meshletCount, -1);
+	brokenMeshlets.assign(header->meshletCount, false);
+	slotMeshlets.assign(slotCount, -1);
+	slotLastVisible.assign(slotCount, 0);
+
+	// The slots are the whole budget, allocated once
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)slotCount * SLOT_VERTEX_BYTES, NULL, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)slotCount * SLOT_INDEX_COUNT * sizeof(unsigned short), NULL, GL_DYNAMIC_DRAW);
+
+	printf("Streaming %u meshlets from %s, %u resident at most (%.1f MB)\n", header->meshletCount, path, slotCount, budgetBytes() / (1024.0 * 1024.0));
+
+	return true;
+}
+
+bool MeshletStreamer::validEntry(unsigned int meshlet) const
+{
+	const MeshletCacheEntry & entry = table[meshlet];
+
+	size_t vertexBytes = entry.vertexCount * sizeof(MeshletVertex);
+	return entry.vertexCount <= MESHLET_MAX_VERTICES && entry.triangleCount <= MESHLET_MAX_TRIANGLES &&
+		entry.dataOffset <= file.size() && file.size() - entry.dataOffset >= entry.dataBytes &&
+		entry.dataBytes >= vertexBytes + entry.triangleCount * 3;
+}
+
+bool MeshletStreamer::pageIn(unsigned int meshlet, unsigned int slot)
+{
+	const MeshletCacheEntry & entry = table[meshlet];
+
+	size_t vertexBytes = entry.vertexCount * sizeof(MeshletVertex);
+
+	// Touching the chunk is what reads it from disk
+	const unsigned char * chunk = file.data() + entry.dataOffset;
+	const unsigned char * triangles = chunk + vertexBytes;
+
+	unsigned short indices[SLOT_INDEX_COUNT];
+	for (unsigned int i = 0; i < entry.triangleCount * 3; ++i)
+	{
+		if (triangles[i] >= entry.vertexCount)
+			return false;
+		indices[i] = triangles[i];
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)slot * SLOT_VERTEX_BYTES, vertexBytes, chunk);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)slot * SLOT_INDEX_COUNT * sizeof(unsigned short), entry.triangleCount * 3 * sizeof(unsigned short), indices);
+
+	// The GPU has its copy, the mapped pages do not need to stay resident
+	file.release(entry.dataOffset, entry.dataBytes);
+
+	return true;
+}
+
+void MeshletStreamer::update(const mat4 & modelViewProjection, const vec3 & cameraPosition, float fovY, int viewportHeight, unsigned int maxPageIns)
+{
+	if (header == NULL)
+		return;
+
+	++frame;
+
+	// Frustum planes from the rows of the matrix, normalized so distances are in model units
+	vec4 rows[4];
+	for (int r = 0; r < 4; ++r)
+		rows[r] = vec4(modelViewProjection[0][r], modelViewProjection[1][r], modelViewProjection[2][r], modelViewProjection[3][r]);
+
+	vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+	for (int p = 0; p < 6; ++p)
+		planes[p] = planes[p] * (1.0f / length(vec3(planes[p].x, planes[p].y, planes[p].z)));
+
+	// Pixels per model unit at distance 1
+	float projectionScale = viewportHeight / (2.0f * tan(fovY * 0.5f));
+
+	visibleMeshlets.clear();
+	lastFrustumCulled = 0;
+	lastConeCulled = 0;
+	lastMissing = 0;
+	lastPagedIn = 0;
+	lastEvicted = 0;
+
+	// Missing meshlets by screen space size, which is the error of leaving them out
+	std::vector<std::pair<float, unsigned int> > requests;
+
+	for (unsigned int m = 0; m < header->meshletCount; ++m)
+	{
+		const MeshletCacheEntry & entry = table[m];
+		vec3 center(entry.center[0], entry.center[1], entry.center[2]);
+
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p)
+			outside = dot(vec3(planes[p].x, planes[p].y, planes[p].z), center) + planes[p].w < -entry.radius;
+
+		if (outside)
+		{
+			++lastFrustumCulled;
+			continue;
+		}
+
+		// Every triangle faces away, cutoffs of 1 and up mark a disabled cone
+		// and are skipped so rounding can not cull a meshlet seen straight down its axis
+		vec3 apex(entry.coneApex[0], entry.coneApex[1], entry.coneApex[2]);
+		vec3 axis(entry.coneAxis[0], entry.coneAxis[1], entry.coneAxis[2]);
+		vec3 toApex = apex - cameraPosition;
+		float apexDistance = length(toApex);
+		if (entry.coneCutoff < 1.0f && apexDistance > 0.0f && dot(toApex / apexDistance, axis) >= entry.coneCutoff)
+		{
+			++lastConeCulled;
+			continue;
+		}
+
+		if (brokenMeshlets[m])
+			continue;
+
+		int slot = meshletSlots[m];
+		if (slot >= 0)
+		{
+			slotLastVisible[slot] = frame;
+			visibleMeshlets.push_back(m);
+			continue;
+		}
+
+		float distance = length(center - cameraPosition) - entry.radius;
+		float screenSize = distance > 0.0f ? entry.radius / distance * projectionScale : FLT_MAX;
+		requests.push_back(std::make_pair(screenSize, m));
+	}
+
+	std::sort(requests.begin(), requests.end(), [](const std::pair<float, unsigned int> & a, const std::pair<float, unsigned int> & b) { return a.first > b.first; });
+
+	// Free slots first, then the least recently visible resident meshlets that are not visible this frame
+	std::vector<std::pair<unsigned int, unsigned int> > evictable;
+	unsigned int nextEvictable = 0;
+	unsigned int nextFree = 0;
+	bool evictableSorted = false;
+
+	for (unsigned int r = 0; r < requests.size(); ++r)
+	{
+		if (lastPagedIn >= maxPageIns)
+		{
+			lastMissing += (unsigned int)requests.size() - r;
+			break;
+		}
+
+		// A corrupt entry must not cost a resident meshlet its slot
+		unsigned int meshlet = requests[r].second;
+		if (!validEntry(meshlet))
+		{
+			printf("Meshlet %u is corrupt, skipping it\n", meshlet);
+			brokenMeshlets[meshlet] = true;
+			continue;
+		}
+
+		int slot = -1;
+		int evicted = -1;
+		while (nextFree < slotCount && slot < 0)
+		{
+			if (slotMeshlets[nextFree] < 0)
+				slot = nextFree;
+			++nextFree;
+		}
+
+		if (slot < 0)
+		{
+			if (!evictableSorted)
+			{
+				for (unsigned int s = 0; s < slotCount; ++s)
+				{
+					if (slotMeshlets[s] >= 0 && slotLastVisible[s] != frame)
+						evictable.push_back(std::make_pair(slotLastVisible[s], s));
+				}
+				std::sort(evictable.begin(), evictable.end());
+				evictableSorted = true;
+			}
+
+			// Everything resident is on screen, the budget is spent
+			if (nextEvictable >= evictable.size())
+			{
+				lastMissing += (unsigned int)requests.size() - r;
+				break;
+			}
+
+			slot = evictable[nextEvictable++].second;
+			evicted = slotMeshlets[slot];
+			meshletSlots[evicted] = -1;
+			slotMeshlets[slot] = -1;
+			--residentMeshlets;
+			++lastEvicted;
+		}
+
+		if (!pageIn(meshlet, slot))
+		{
+			printf("Meshlet %u is corrupt, skipping it\n", meshlet);
+			brokenMeshlets[meshlet] = true;
+
+			// pageIn left the slot alone, give it back to whoever had it, or to the free search
+			if (evicted >= 0)
+			{
+				meshletSlots[evicted] = slot;
+				slotMeshlets[slot] = evicted;
+				++residentMeshlets;
+				--lastEvicted;
+				--nextEvictable;
+			}
+			else
+				nextFree = slot;
+			continue;
+		}
+
+		meshletSlots[meshlet] = slot;
+		slotMeshlets[slot] = meshlet;
+		slotLastVisible[slot] = frame;
+		++residentMeshlets;
+		++lastPagedIn;
+
+		visibleMeshlets.push_back(meshlet);
+	}
+
+	lastVisible = (unsigned int)visibleMeshlets.size() + lastMissing;
+}
+
+void MeshletStreamer::draw()
+{
+	if (visibleMeshlets.empty())
+		return;
+
+	drawCounts.clear();
+	drawOffsets.clear();
+	drawBaseVertices.clear();
+
+	for (unsigned int i = 0; i < visibleMeshlets.size(); ++i)
+	{
+		unsigned int meshlet = visibleMeshlets[i];
+		int slot = meshletSlots[meshlet];
+
+		drawCounts.push_back(table[meshlet].triangleCount * 3);
+		drawOffsets.push_back((void*)((size_t)slot * SLOT_INDEX_COUNT * sizeof(unsigned short)));
+		drawBaseVertices.push_back(slot * MESHLET_MAX_VERTICES);
+	}
+
+	// Interleaved position, UV, normal
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshletVertex), (void*)0);
+
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MeshletVertex), (void*)(3 * sizeof(float)));
+
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(MeshletVertex), (void*)(5 * sizeof(float)));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	// One call for every visible meshlet, core since GL 3.2
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_SHORT, (void**)drawOffsets.data(), (GLsizei)drawCounts.size(), drawBaseVertices.data());
+}
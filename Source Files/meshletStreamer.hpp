@@ -0,0 +1,82 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "assetCache.hpp"
+#include "mappedFile.hpp"
+
+using namespace glm;
+
+// Draws a meshlet cache that does not have to fit in memory
+// The file is mapped and only its meshlet table is read up front. Every frame meshlets are culled against the
+// frustum and their normal cones, and missing visible ones are copied into fixed size GPU slots, biggest on screen first.
+// The slots are the whole resident budget, once they are full the least recently visible meshlets are evicted.
+class MeshletStreamer
+{
+public:
+	MeshletStreamer();
+	~MeshletStreamer();
+
+	// Needs a current GL context, residentBudget is in bytes of GPU storage
+	bool open(const char * path, unsigned long long residentBudget);
+
+	// Culls and pages in at most maxPageIns meshlets
+	// The mesh is drawn in model space, so the camera position is in model space too
+	void update(const mat4 & modelViewProjection, const vec3 & cameraPosition, float fovY, int viewportHeight, unsigned int maxPageIns);
+
+	// Draws the visible resident meshlets with the program already in use, attributes 0 to 2 are left enabled
+	void draw();
+
+	unsigned int meshletCount() const { return header != NULL ? header->meshletCount : 0; }
+	unsigned int residentCount() const { return residentMeshlets; }
+	unsigned long long residentBytes() const { return (unsigned long long)residentMeshlets * slotBytes; }
+	unsigned long long budgetBytes() const { return (unsigned long long)slotCount * slotBytes; }
+
+	// Last update's counts
+	unsigned int visibleCount() const { return lastVisible; }
+	unsigned int frustumCulledCount() const { return lastFrustumCulled; }
+	unsigned int coneCulledCount() const { return lastConeCulled; }
+	unsigned int missingCount() const { return lastMissing; }	// Visible but not resident, so not drawn
+	unsigned int pagedInCount() const { return lastPagedIn; }
+	unsigned int evictedCount() const { return lastEvicted; }
+
+private:
+	// Whether a meshlet's table entry fits the limits and points inside the file, checked before a slot is given up for it
+	bool validEntry(unsigned int meshlet) const;
+
+	// Copies a meshlet's chunk from the mapping into a slot, the entry must be valid
+	// Fails without touching the slot if the chunk's triangles index past its vertices
+	bool pageIn(unsigned int meshlet, unsigned int slot);
+
+	MappedFile file;
+	const MeshletCacheHeader * header;
+	const MeshletCacheEntry * table;
+
+	unsigned int slotCount;
+	unsigned int slotBytes;
+	unsigned int residentMeshlets;
+
+	std::vector<int> meshletSlots;				// Slot holding each meshlet, -1 if not resident
+	std::vector<int> slotMeshlets;				// Meshlet in each slot, -1 if free
+	std::vector<unsigned int> slotLastVisible;	// Frame the slot's meshlet was last visible
+	std::vector<bool> brokenMeshlets;			// Failed validation, never paged in again
+
+	unsigned int frame;
+	std::vector<unsigned int> visibleMeshlets;
+
+	// Per frame draw arguments for glMultiDrawElementsBaseVertex
+	std::vector<GLsizei> drawCounts;
+	std::vector<void*> drawOffsets;
+	std::vector<GLint> drawBaseVertices;
+
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+
+	unsigned int lastVisible;
+	unsigned int lastFrustumCulled;
+	unsigned int lastConeCulled;
+	unsigned int lastMissing;
+	unsigned int lastPagedIn;
+	unsigned int lastEvicted;
+};
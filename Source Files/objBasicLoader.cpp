@@ -1,10 +1,14 @@
 #include "objBasicLoader.hpp"
 
-bool loadOBJ(const char * path, std::vector <glm::vec3> & out_vertices, std::vector <glm::vec2> & out_uvs, std::vector <glm::vec3> & out_normals)
+bool loadOBJ(const char * path, std::vector <glm::vec3> & out_vertices, std::vector <glm::vec2> & out_uvs, std::vector <glm::vec3> & out_normals, Arena * arena)
 {
-	std::vector <unsigned int> vertexIndices, uvIndicies, normalIndicies;
-	std::vector <vec3> temp_vertices, temp_normals; 
-	std::vector <vec2> temp_uvs;
+	ArenaAllocator<unsigned int> indexAllocator(arena);
+	ArenaAllocator<vec3> vec3Allocator(arena);
+	ArenaAllocator<vec2> vec2Allocator(arena);
+
+	std::vector <unsigned int, ArenaAllocator<unsigned int> > vertexIndices(indexAllocator), uvIndicies(indexAllocator), normalIndicies(indexAllocator);
+	std::vector <vec3, ArenaAllocator<vec3> > temp_vertices(vec3Allocator), temp_normals(vec3Allocator); 
+	std::vector <vec2, ArenaAllocator<vec2> > temp_uvs(vec2Allocator);
 
 	// Open a file 
 	FILE *file = fopen(path, "r");
@@ -15,6 +19,29 @@ bool loadOBJ(const char * path, std::vector <glm::vec3> & out_vertices, std::vec
 		return false;
 	}
 
+	// Count the elements first so every array is allocated once
+	unsigned int vertexCount = 0, uvCount = 0, normalCount = 0, faceCount = 0;
+	char line[1000];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		if (line[0] == 'v' && line[1] == ' ')
+			++vertexCount;
+		else if (line[0] == 'v' && line[1] == 't')
+			++uvCount;
+		else if (line[0] == 'v' && line[1] == 'n')
+			++normalCount;
+		else if (line[0] == 'f' && line[1] == ' ')
+			++faceCount;
+	}
+	rewind(file);
+
+	temp_vertices.reserve(vertexCount);
+	temp_uvs.reserve(uvCount);
+	temp_normals.reserve(normalCount);
+	vertexIndices.reserve(faceCount * 3);
+	uvIndicies.reserve(faceCount * 3);
+	normalIndicies.reserve(faceCount * 3);
+
 	// Read the file line by line 
 	while (true)
 	{
@@ -87,6 +114,10 @@ bool loadOBJ(const char * path, std::vector <glm::vec3> & out_vertices, std::vec
 
 	// Now we match the indicies of the faces with the actual data
 	// Note obj's index at 1 and our arrays index at 0
+	out_vertices.reserve(out_vertices.size() + vertexIndices.size());
+	out_uvs.reserve(out_uvs.size() + vertexIndices.size());
+	out_normals.reserve(out_normals.size() + vertexIndices.size());
+
 	for (unsigned int i = 0; i < vertexIndices.size(); ++i)
 	{
 		out_vertices.push_back(temp_vertices[vertexIndices[i] - 1]);
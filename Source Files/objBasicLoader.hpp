@@ -3,11 +3,15 @@
 #include <glm/glm.hpp>
 #include <vector>
 
+#include "arena.hpp"
+
 using namespace glm;
 
+// Temporaries are allocated from arena when one is given, otherwise from the heap
 bool loadOBJ(
 	const char * path,
 	std::vector <vec3> & out_vertices,
 	std::vector <vec2> & out_uvs,
-	std::vector <vec3> & out_normals
+	std::vector <vec3> & out_normals,
+	Arena * arena = NULL
 );
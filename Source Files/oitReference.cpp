@@ -0,0 +1,98 @@
+#include "oitReference.hpp"
+
+#include <stdio.h>
+#include <algorithm>	// For sort, shuffle, max
+#include <cmath>		// For pow, fabs
+#include <random>
+
+float oitWeight(float depth, float alpha)
+{
+	// McGuire and Bavoil's depth weight, keeps near fragments dominant while staying within half float range
+	return alpha * clamp(10.0f / (1e-5f + std::pow(depth / 5.0f, 2.0f) + std::pow(depth / 200.0f, 6.0f)), 1e-2f, 3e3f);
+}
+
+vec3 compositeWeighted(const std::vector<OITFragment> & fragments, const vec3 & background)
+{
+	// Accumulation pass, what the two render targets hold after blending
+	vec3 accumulatedColor(0.0f);
+	float revealage = 1.0f;
+	float weightSum = 0.0f;
+
+	for (unsigned int i = 0; i < fragments.size(); ++i)
+	{
+		float weight = oitWeight(fragments[i].depth, fragments[i].alpha);
+
+		accumulatedColor += fragments[i].color * fragments[i].alpha * weight;
+		revealage *= 1.0f - fragments[i].alpha;
+		weightSum += fragments[i].alpha * weight;
+	}
+
+	// Composite pass
+	if (revealage == 1.0f)
+		return background;
+
+	vec3 averageColor = accumulatedColor / std::max(weightSum, 1e-5f);
+	return averageColor * (1.0f - revealage) + background * revealage;
+}
+
+vec3 compositeSorted(std::vector<OITFragment> fragments, const vec3 & background)
+{
+	std::sort(fragments.begin(), fragments.end(), [](const OITFragment & a, const OITFragment & b) { return a.depth > b.depth; });
+
+	vec3 result = background;
+	for (unsigned int i = 0; i < fragments.size(); ++i)
+		result = fragments[i].color * fragments[i].alpha + result * (1.0f - fragments[i].alpha);
+
+	return result;
+}
+
+bool runOITReferenceCheck(int pixelCount, int maxLayers, float alpha, float meanErrorTolerance, float maxErrorTolerance)
+{
+	// Fixed seed so the numbers can be compared between runs
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> colorDistribution(0.0f, 1.0f);
+	std::uniform_real_distribution<float> depthDistribution(0.5f, 50.0f);
+	std::uniform_int_distribution<int> layerDistribution(1, std::max(1, maxLayers));
+
+	const vec3 background(0.0f);
+
+	double errorSum = 0.0;
+	float errorMax = 0.0f;
+	float orderErrorMax = 0.0f;
+
+	std::vector<OITFragment> fragments;
+
+	for (int p = 0; p < pixelCount; ++p)
+	{
+		fragments.resize(layerDistribution(generator));
+		for (unsigned int i = 0; i < fragments.size(); ++i)
+		{
+			fragments[i].color = vec3(colorDistribution(generator), colorDistribution(generator), colorDistribution(generator));
+			fragments[i].alpha = alpha;
+			fragments[i].depth = depthDistribution(generator);
+		}
+
+		vec3 weighted = compositeWeighted(fragments, background);
+		vec3 sorted = compositeSorted(fragments, background);
+
+		float error = std::max(std::max(std::fabs(weighted.x - sorted.x), std::fabs(weighted.y - sorted.y)), std::fabs(weighted.z - sorted.z));
+		errorSum += error;
+		errorMax = std::max(errorMax, error);
+
+		// Submission order must not matter, up to float summation order
+		std::shuffle(fragments.begin(), fragments.end(), generator);
+		vec3 shuffled = compositeWeighted(fragments, background);
+		orderErrorMax = std::max(orderErrorMax, std::max(std::max(std::fabs(shuffled.x - weighted.x), std::fabs(shuffled.y - weighted.y)), std::fabs(shuffled.z - weighted.z)));
+	}
+
+	double errorMean = pixelCount > 0 ? errorSum / pixelCount : 0.0;
+
+	printf("OIT reference: %d pixels, up to %d layers, alpha %f\n", pixelCount, maxLayers, alpha);
+	printf("Weighted vs sorted error: mean %f (at most %f), max %f (at most %f)\n", errorMean, meanErrorTolerance, errorMax, maxErrorTolerance);
+	printf("Weighted order dependence: max %g (at most %g)\n", orderErrorMax, OIT_ORDER_TOLERANCE);
+
+	bool passed = orderErrorMax <= OIT_ORDER_TOLERANCE && errorMean <= meanErrorTolerance && errorMax <= maxErrorTolerance;
+	printf("OIT reference %s\n", passed ? "passed" : "FAILED");
+
+	return passed;
+}
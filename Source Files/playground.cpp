@@ -13,11 +13,23 @@ GLFWwindow* window;
 #include <common/shader.hpp>	// For loading shaders
 #include <common/objBasicLoader.hpp>	// For loading obj files
 #include <common/vboindexer.hpp>	// For VBO indexing
+#include <common/benchmark.hpp>	// For the scripted benchmark mode
+#include <common/lightClusters.hpp>	// For clustered lighting
+#include <common/oitReference.hpp>	// For checking weighted blended transparency
+#include <common/hiZBuffer.hpp>	// For occlusion culling
+#include <common/meshBuffer.hpp>	// For the shared vertex and index buffers
+#include <common/indirectDraw.hpp>	// For indirect draw submission
+#include <common/arena.hpp>	// For loader temporaries
+#include <common/imageLoader.hpp>	// For decoding BMP and TGA files
+#include <common/meshletStreamer.hpp>	// For out of core meshes
 
 #include <chrono>	// For high_resolution_clock
 #include <cmath>	// For fmod
 #include <algorithm>	// For clamp
 #include <vector>
+#include <random>	// For the generated lights
+#include <string.h>	// For strcmp
+#include <float.h>	// For FLT_MAX
 
 using namespace glm;
 
@@ -25,20 +37,26 @@ using namespace glm;
 const GLfloat ROTATION_SPEED =	1.0f;
 const GLfloat COLOR_SPEED =		0.5f;
 
+// Meshlets copied to the GPU per frame at most, so a sudden turn does not stall one frame on paging
+const unsigned int MESHLET_PAGE_INS_PER_FRAME = 256;
+
 // In watts
 const GLfloat LIGHT_INTENSITY = 50.0f;
 // In RGB
 const vec3 LIGHT_COLOR =		vec3(1, 1, 1);
+// In world space
+const vec3 LIGHT_POSITION =		vec3(4, 4, 4);
 
 // Time between most two frames in seconds
 GLfloat deltaTime = 0.0f;
 
-// BMP loading function  
+// BMP and TGA loading function
 GLuint loadBMP_custom(const char * imagepath);
 GLuint loadDDS(const char * imagepath);
 
 // Interfacing function
 void computeMatriciesFromInputs();
+void computeMatriciesFromPath(const CameraPath & path, float t);
 mat4 getProjectionMatrix();
 mat4 getViewMatrix();
 
@@ -52,6 +70,11 @@ float verticalAngle = 0;
 
 float FOV = 45.0f;
 
+// Projection set up, shared with the light clustering
+const float ASPECT_RATIO =	4.0f / 3.0f;
+const float Z_NEAR =		0.1f;
+const float Z_FAR =			100.0f;
+
 int windowWidth = 0;
 int windowHeight = 0;
 
@@ -61,8 +84,83 @@ const float ALPHA = 0.6f;
 
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
-int main( void )
+// Adds the main light plus count smaller randomly placed ones
+void generateLights(int count, std::vector<PointLight> & out_lights);
+
+// Lays count objects out on a grid centered on the origin
+void generateObjectPositions(int count, std::vector<vec3> & out_positions);
+
+// How transparent objects are composited
+enum TransparencyMode
+{
+	TRANSPARENCY_OPAQUE,	// No blending, objects are drawn with full alpha
+	TRANSPARENCY_BLEND,		// Alpha blending in submission order, wrong wherever objects overlap
+	TRANSPARENCY_SORTED,	// Alpha blending with objects sorted back to front on the CPU every frame
+	TRANSPARENCY_OIT		// Weighted blended order independent transparency
+};
+
+// Command line options
+// --bench replays a camera path at a fixed time step with no input polling, vsync off and
+// rendering into an offscreen framebuffer, then writes the frame timings as JSON
+struct Options
 {
+	bool bench = false;
+	int benchFrames = 1000;
+	float benchTimeStep = 1.0f / 60.0f;
+	const char * benchPath = NULL;
+	const char * benchOutput = "bench_output.json";
+	const char * recordPath = NULL;
+	int lightCount = 0;
+	int objectCount = 1;
+	TransparencyMode transparency = TRANSPARENCY_OIT;
+	bool oitReference = false;
+	bool prepass = false;
+	bool hiz = false;
+	bool indirect = false;
+	bool indirectLoop = false;
+	bool arena = true;
+	const char * meshletPath = NULL;
+	int meshletBudgetMB = 64;
+	const char * texturePath = NULL;
+};
+
+bool parseOptions(int argc, char * argv[], Options & options);
+
+int main( int argc, char * argv[] )
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return -1;
+	}
+
+	// CPU only check of the transparency math, no window needed
+	if (options.oitReference)
+	{
+		return runOITReferenceCheck(100000, 16, ALPHA) ? 0 : 1;
+	}
+
+	CameraPath cameraPath;
+	if (options.bench)
+	{
+		if (options.benchPath != NULL)
+		{
+			if (!cameraPath.loadFromFile(options.benchPath))
+				return -1;
+		}
+		else
+		{
+			// Ten second orbit around the model at the default viewing distance
+			cameraPath.makeDefaultOrbit(5.0f, 1.0f, 10.0f);
+		}
+	}
+
+	CameraRecorder cameraRecorder;
+	if (options.recordPath != NULL && !cameraRecorder.open(options.recordPath))
+	{
+		return -1;
+	}
+
 	// Initialise GLFW
 	if( !glfwInit() )
 	{
@@ -71,13 +169,20 @@ int main( void )
 		return -1;
 	}
 
-	glfwWindowHint(GLFW_SAMPLES, 4);
+	// Frames rendered offscreen are blitted to the window, which is not allowed into a multisampled one
+	bool offscreen = options.bench || options.prepass;
+
+	glfwWindowHint(GLFW_SAMPLES, offscreen ? 0 : 4);
 	glfwWindowHint(GLFW_RESIZABLE,GL_FALSE);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+	// The benchmark renders offscreen, the window only provides the context
+	if (options.bench)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
 	// Open a window and create its OpenGL context
 	window = glfwCreateWindow( 1024, 768, "Playground", NULL, NULL);
 
@@ -109,6 +214,84 @@ int main( void )
 	// Ensure we can capture the escape key being pressed below
 	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 
+	// Frame times must not be capped by the display refresh
+	if (options.bench)
+		glfwSwapInterval(0);
+
+	// Offscreen target for the benchmark, the hidden window's framebuffer is not guaranteed to be rendered
+	// Also used by the depth prepass, whose depth is read back as a texture for the hierarchical Z buffer
+	GLuint offscreenFramebuffer = 0;
+	GLuint offscreenColorBuffer = 0;
+	GLuint offscreenDepthTexture = 0;
+
+	if (offscreen)
+	{
+		glGenRenderbuffers(1, &offscreenColorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, offscreenColorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, windowWidth, windowHeight);
+
+		glGenTextures(1, &offscreenDepthTexture);
+		glBindTexture(GL_TEXTURE_2D, offscreenDepthTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, windowWidth, windowHeight, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glGenFramebuffers(1, &offscreenFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColorBuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, offscreenDepthTexture, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			fprintf(stderr, "Failed to create the offscreen framebuffer\n");
+			glfwTerminate();
+			return -1;
+		}
+
+		glViewport(0, 0, windowWidth, windowHeight);
+	}
+
+	// Framebuffer the frame ends up in
+	GLuint outputFramebuffer = offscreenFramebuffer;
+
+	// Weighted blended transparency targets
+	// Attachment 0 sums color * alpha * weight in rgb and blends the product of (1 - alpha) into a
+	// Attachment 1 sums alpha * weight
+	// Both use the same blend function, GL 3.3 has no per target blending
+	GLuint oitFramebuffer = 0;
+	GLuint oitTextures[2] = { 0, 0 };
+
+	if (options.transparency == TRANSPARENCY_OIT)
+	{
+		const GLenum internalFormats[2] = { GL_RGBA16F, GL_R16F };
+		const GLenum formats[2] = { GL_RGBA, GL_RED };
+
+		glGenTextures(2, oitTextures);
+		glGenFramebuffers(1, &oitFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, oitFramebuffer);
+
+		for (int i = 0; i < 2; ++i)
+		{
+			glBindTexture(GL_TEXTURE_2D, oitTextures[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], windowWidth, windowHeight, 0, formats[i], GL_FLOAT, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, oitTextures[i], 0);
+		}
+
+		const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, drawBuffers);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			fprintf(stderr, "Failed to create the transparency framebuffer\n");
+			glfwTerminate();
+			return -1;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+	}
+
 	// Black blue background
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
@@ -117,65 +300,96 @@ int main( void )
 	glGenVertexArrays(1, &VertexArrayID);
 	glBindVertexArray(VertexArrayID);
 
-	// Load from obj file
-	std::vector <vec3> vertices; 
-	std::vector <vec2> uvs;
-	std::vector <vec3> normals;
-	
-	if (!loadOBJ("suzanne.obj", vertices, uvs, normals))
+	// Every mesh goes into the same buffers, objects cycle through them
+	const char * meshPaths[2] = { "suzanne.obj", "cube.obj" };
+	MeshBuffer meshBuffer;
+
+	// Loader temporaries for every mesh come out of one arena, reset between meshes
+	Arena loaderArena;
+	Arena * meshArena = options.arena ? &loaderArena : NULL;
+	resetHeapAllocationStats();
+
+	auto loadBegin = std::chrono::high_resolution_clock::now();
+
+	for (int m = 0; m < 2; ++m)
 	{
-		printf("Failed to load OBJ\n");
+		// Load from obj file
+		std::vector <vec3> vertices; 
+		std::vector <vec2> uvs;
+		std::vector <vec3> normals;
+	
+		if (!loadOBJ(meshPaths[m], vertices, uvs, normals, meshArena))
+		{
+			printf("Failed to load OBJ\n");
+			continue;
+		}
+
+		// Fill VBO index buffer
+		std::vector<unsigned short> indices;
+		std::vector<glm::vec3> indexed_vertices;
+		std::vector<glm::vec2> indexed_uvs;
+		std::vector<glm::vec3> indexed_normals;
+
+		indexVBO(vertices, uvs, normals, indices, indexed_vertices, indexed_uvs, indexed_normals, meshArena);
+
+		meshBuffer.addMesh(indices, indexed_vertices, indexed_uvs, indexed_normals);
+
+		loaderArena.reset();
 	}
 
-	// Fill VBO index buffer
-	std::vector<unsigned short> indices;
-	std::vector<glm::vec3> indexed_vertices;
-	std::vector<glm::vec2> indexed_uvs;
-	std::vector<glm::vec3> indexed_normals;
+	auto loadEnd = std::chrono::high_resolution_clock::now();
+	double loadMS = std::chrono::duration_cast<std::chrono::microseconds>(loadEnd - loadBegin).count() / 1000.0;
+	unsigned long long loadAllocations = heapAllocationCount();
+	unsigned long long loadAllocationBytes = heapAllocationBytes();
+
+	printf("Loaded %u meshes in %f ms, %llu loader heap allocations, %llu bytes%s\n", meshBuffer.meshCount(), loadMS,
+		loadAllocations, loadAllocationBytes, options.arena ? " (arena)" : "");
+
+	if (meshBuffer.meshCount() == 0)
+	{
+		fprintf(stderr, "No mesh could be loaded\n");
+		glfwTerminate();
+		return -1;
+	}
 
-	indexVBO(vertices, uvs, normals, indices, indexed_vertices, indexed_uvs, indexed_normals);
+	meshBuffer.upload();
 
 	// Load Texture
-	GLuint texture = loadDDS("suzanneuvmap.dds");
-
-	// ID for buffers
-	GLuint vertexBuffer;
-	GLuint UVBuffer;
-	GLuint normalBuffer;
-	GLuint elementBuffer;
-
-	// Generates a buffer and puts resulting ID in buffer ID's
-	// NOTE, THE ORDER IN THE FOLLOWING FUNCTION CALLS MATTERS! GROUP THEM TOGETHER
-	// We use the indexed buffers now
-	glGenBuffers(1, &vertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, indexed_vertices.size() * sizeof(vec3), &indexed_vertices[0], GL_STATIC_DRAW);
-	
-	glGenBuffers(1, &UVBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, UVBuffer);
-	glBufferData(GL_ARRAY_BUFFER, indexed_uvs.size() * sizeof(vec3), &indexed_uvs[0], GL_STATIC_DRAW);
+	auto textureBegin = std::chrono::high_resolution_clock::now();
+	GLuint texture = options.texturePath != NULL ? loadBMP_custom(options.texturePath) : loadDDS("suzanneuvmap.dds");
+	double textureLoadMS = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - textureBegin).count() / 1000.0;
 
-	glGenBuffers(1, &normalBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-	glBufferData(GL_ARRAY_BUFFER, indexed_normals.size() * sizeof(vec3), &indexed_normals[0], GL_STATIC_DRAW);
+	if (texture == 0)
+	{
+		fprintf(stderr, "No texture could be loaded\n");
+		glfwTerminate();
+		return -1;
+	}
 
-	// Element buffer for VBO indexing
-	glGenBuffers(1, &elementBuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	printf("Loaded texture in %f ms\n", textureLoadMS);
 
 	// Enable depth test
 	glEnable(GL_DEPTH_TEST);
 
 	// Enable blending
-	glEnable(GL_BLEND);
+	if (options.transparency != TRANSPARENCY_OPAQUE)
+		glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// Accept fragment if it closer to the camera than the former one
 	glDepthFunc(GL_LESS);
 
 	// Load up shaders
-	GLuint programID = LoadShaders("basicVertexShader.glsl", "basicFragmentShader.glsl");
+	// Indirect draws read their model matrices from a buffer instead of uniforms
+	GLuint programID = LoadShaders(options.indirect ? "indirectVertexShader.glsl" : "basicVertexShader.glsl", "basicFragmentShader.glsl");
+	GLuint compositeProgramID = LoadShaders("fullScreenVertexShader.glsl", "oitCompositeFragmentShader.glsl");
+	GLuint depthProgramID = LoadShaders("depthOnlyVertexShader.glsl", "depthOnlyFragmentShader.glsl");
+	GLuint depthMatrixID = glGetUniformLocation(depthProgramID, "MVP");
+
+	// The composite pass reads the transparency targets from texture units 0 and 1
+	glUseProgram(compositeProgramID);
+	glUniform1i(glGetUniformLocation(compositeProgramID, "accumulationSampler"), 0);
+	glUniform1i(glGetUniformLocation(compositeProgramID, "weightSampler"), 1);
 
 	// Model matrix set up
 	// Rotate about Z axis
@@ -187,48 +401,137 @@ int main( void )
 	GLuint matrixID =	glGetUniformLocation(programID, "MVP");
 	GLuint mID =		glGetUniformLocation(programID, "M");
 	GLuint vID =		glGetUniformLocation(programID, "V");
+	GLuint vpID =		glGetUniformLocation(programID, "VP");
 	GLuint textureID =	glGetUniformLocation(programID, "myTextureSampler");
-	GLuint lightID =	glGetUniformLocation(programID, "lightPosition_worldSpace");
-	GLuint colorID =	glGetUniformLocation(programID, "lightColor");
-	GLuint strengthID =	glGetUniformLocation(programID, "lightStrength");
 	GLuint alphaID =	glGetUniformLocation(programID, "alpha");
+	GLuint oitID =		glGetUniformLocation(programID, "weightedOIT");
+
+	// Objects and the order they are drawn in
+	std::vector<vec3> objectPositions;
+	generateObjectPositions(options.objectCount, objectPositions);
+
+	std::vector<unsigned int> objectMeshes(objectPositions.size());
+	for (unsigned int i = 0; i < objectMeshes.size(); ++i)
+		objectMeshes[i] = i % meshBuffer.meshCount();
+
+	std::vector<unsigned int> drawOrder(objectPositions.size());
+	for (unsigned int i = 0; i < drawOrder.size(); ++i)
+		drawOrder[i] = i;
+
+	std::vector<float> objectDepths(objectPositions.size());
+	double sortMSTotal = 0.0;
+
+	// Objects that survive occlusion culling this frame
+	std::vector<unsigned int> visibleOrder;
+	std::vector<mat4> objectModelMatrices(objectPositions.size());
+
+	HiZBuffer hiZBuffer;
+	if (options.hiz)
+		hiZBuffer.init(windowWidth, windowHeight);
+
+	// Samples passing the depth test in the prepass and in the shading pass
+	// The prepass count is what would have been shaded without it. Results are read a frame late to avoid stalling.
+	GLuint sampleQueries[2][2];
+	glGenQueries(4, &sampleQueries[0][0]);
+	double prepassSamplesTotal = 0.0;
+	double shadedSamplesTotal = 0.0;
+	double occludedTotal = 0.0;
+	GLuint lastPrepassSamples = 0;
+	GLuint lastShadedSamples = 0;
+	unsigned int occludedCount = 0;
+
+	// Draw commands for the indirect path
+	IndirectDrawList indirectDraws;
+	bool multiDraw = false;
+	if (options.indirect)
+	{
+		indirectDraws.init((unsigned int)objectPositions.size());
+
+		multiDraw = !options.indirectLoop && IndirectDrawList::multiDrawSupported();
+		if (!multiDraw && !options.indirectLoop)
+			printf("ARB_multi_draw_indirect or ARB_base_instance is not supported, looping over the draw commands instead\n");
+	}
+
+	// CPU time spent submitting the scene's draws
+	double submitMSTotal = 0.0;
+	double drawsTotal = 0.0;
+
+	// Mesh streamed from a meshlet cache, drawn at the origin with the objects
+	MeshletStreamer meshletStreamer;
+	if (options.meshletPath != NULL && !meshletStreamer.open(options.meshletPath, (unsigned long long)options.meshletBudgetMB * 1024 * 1024))
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	double streamMSTotal = 0.0;
+	double residentMBTotal = 0.0;
+	double visibleMeshletsTotal = 0.0;
+	double frustumCulledTotal = 0.0;
+	double coneCulledTotal = 0.0;
+	double missingMeshletsTotal = 0.0;
+	double pagedInTotal = 0.0;
+	double evictedTotal = 0.0;
+
+	// Set up lights, binned into clusters every frame
+	std::vector<PointLight> lights;
+	generateLights(options.lightCount, lights);
+
+	LightClusterGrid lightClusters;
+	lightClusters.init();
+
+	double binningMSTotal = 0.0;
+	double lightsPerClusterTotal = 0.0;
 
 	// First time stamp
 	auto begin = std::chrono::high_resolution_clock::now();
 
 	GLfloat colorVal = 0.0f;
 
+	// Simulated time, advanced by the fixed time step in benchmark mode
+	float simulationTime = 0.0f;
+	int frameCount = 0;
+	BenchmarkStats benchStats;
+
+	if (options.bench)
+		deltaTime = options.benchTimeStep;
+
 	do{
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Use the shaders we set up earlier
 		glUseProgram(programID);
 
-		// Compute the MVP matrix from keyboard and mouse input
-		computeMatriciesFromInputs();
+		// Compute the MVP matrix from keyboard and mouse input, or from the scripted path
+		if (options.bench)
+			computeMatriciesFromPath(cameraPath, simulationTime);
+		else
+			computeMatriciesFromInputs();
+
+		cameraRecorder.record(simulationTime, position, horizontalAngle, verticalAngle);
+
+		// Assign lights to the clusters of this view
+		lightClusters.update(lights, viewMatrix, radians(FOV), ASPECT_RATIO, Z_NEAR, Z_FAR);
+		binningMSTotal += lightClusters.binningMS();
+		lightsPerClusterTotal += lightClusters.averageLightsPerCluster();
 
 		// Create a rotation matrix about the z axis
 		mat4 rotationMatrix = rotate((ROTATION_SPEED * deltaTime), modelRotationAxis);
 
-		// Apply rotation matrix to model matrix
+		// Apply rotation matrix to model matrix, every object spins the same way around its own center
 		modelMatrix *= rotationMatrix;
 
-		// Apply model matrix to MVP matrix
-		mat4 mvpMatrix = projectionMatrix * viewMatrix * modelMatrix;
-
 		// Send the matrix to the shader
-		glUniformMatrix4fv(matrixID, 1, GL_FALSE, &mvpMatrix[0][0]);
-		glUniformMatrix4fv(mID, 1, GL_FALSE, &modelMatrix[0][0]);
+		mat4 vpMatrix = projectionMatrix * viewMatrix;
 		glUniformMatrix4fv(vID, 1, GL_FALSE, &viewMatrix[0][0]);
+		glUniformMatrix4fv(vpID, 1, GL_FALSE, &vpMatrix[0][0]);
 
-		// Set up light
-		glm::vec3 lightPos = glm::vec3(4, 4, 4);
-		glUniform3f(lightID, lightPos.x, lightPos.y, lightPos.z);
-		glUniform3f(colorID, LIGHT_COLOR.x, LIGHT_COLOR.y, LIGHT_COLOR.z);
-		glUniform1f(strengthID, LIGHT_INTENSITY);
+		// Set up lights, texture units 1 to 3 hold the cluster data
+		lightClusters.bind(programID, 1, windowWidth, windowHeight);
 
 		// Set up alpha channel
-		glUniform1f(alphaID, ALPHA);
+		glUniform1f(alphaID, options.transparency == TRANSPARENCY_OPAQUE ? 1.0f : ALPHA);
+		glUniform1i(oitID, options.transparency == TRANSPARENCY_OIT);
 
 		// Bind our texture in Texture Unit 0
 		glActiveTexture(GL_TEXTURE0);
@@ -237,59 +540,227 @@ int main( void )
 		glUniform1i(textureID, 0);
 
 		// Draw triangle
-		// Attribute for vertex buffer
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-		glVertexAttribPointer
-		(
-			0,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// Attribute for UV buffer
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, UVBuffer);
-		glVertexAttribPointer
-		(
-			1,                  // attribute 2
-			2,                  // size 2, because 2D coordinates
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-		glVertexAttribPointer(
-			2,                                // attribute 3
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// Index buffer
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
-
-		// Draw the triangles !
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			indices.size(),    // count
-			GL_UNSIGNED_SHORT,   // type
-			(void*)0           // element array buffer offset
-		);
+		meshBuffer.bindAttributes();
+
+		// Back to front by camera space depth of the object centers
+		if (options.transparency == TRANSPARENCY_SORTED)
+		{
+			auto sortBegin = std::chrono::high_resolution_clock::now();
+
+			for (unsigned int i = 0; i < objectPositions.size(); ++i)
+				objectDepths[i] = -(viewMatrix * vec4(objectPositions[i], 1.0f)).z;
+
+			std::sort(drawOrder.begin(), drawOrder.end(), [&objectDepths](unsigned int a, unsigned int b) { return objectDepths[a] > objectDepths[b]; });
+
+			auto sortEnd = std::chrono::high_resolution_clock::now();
+			sortMSTotal += std::chrono::duration_cast<std::chrono::microseconds>(sortEnd - sortBegin).count() / 1000.0;
+		}
+
+		// Model matrices, then drop the objects hidden behind last frame's depth
+		visibleOrder.clear();
+		occludedCount = 0;
+
+		if (options.hiz)
+			hiZBuffer.fetchReadback();
+
+		for (unsigned int i = 0; i < drawOrder.size(); ++i)
+		{
+			unsigned int object = drawOrder[i];
+			objectModelMatrices[object] = translate(mat4(1.0f), objectPositions[object]) * modelMatrix;
+
+			if (options.hiz)
+			{
+				// World space bounds of the rotated mesh
+				const MeshRecord & mesh = meshBuffer.mesh(objectMeshes[object]);
+				vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+				for (int corner = 0; corner < 8; ++corner)
+				{
+					vec3 p((corner & 1) ? mesh.boundsMax.x : mesh.boundsMin.x, (corner & 2) ? mesh.boundsMax.y : mesh.boundsMin.y, (corner & 4) ? mesh.boundsMax.z : mesh.boundsMin.z);
+					vec4 world = objectModelMatrices[object] * vec4(p, 1.0f);
+					boxMin = min(boxMin, vec3(world.x, world.y, world.z));
+					boxMax = max(boxMax, vec3(world.x, world.y, world.z));
+				}
+
+				if (hiZBuffer.isOccluded(boxMin, boxMax))
+				{
+					++occludedCount;
+					continue;
+				}
+			}
+
+			visibleOrder.push_back(object);
+		}
+
+		// Last frame's sample counts
+		if (options.prepass && frameCount > 0)
+		{
+			int previous = (frameCount - 1) % 2;
+			glGetQueryObjectuiv(sampleQueries[previous][0], GL_QUERY_RESULT, &lastPrepassSamples);
+			glGetQueryObjectuiv(sampleQueries[previous][1], GL_QUERY_RESULT, &lastShadedSamples);
+			prepassSamplesTotal += lastPrepassSamples;
+			shadedSamplesTotal += lastShadedSamples;
+		}
+
+		// Depth only pass, the shading pass after it only runs the fragment shader on visible pixels
+		if (options.prepass)
+		{
+			glUseProgram(depthProgramID);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glBeginQuery(GL_SAMPLES_PASSED, sampleQueries[frameCount % 2][0]);
+
+			for (unsigned int i = 0; i < visibleOrder.size(); ++i)
+			{
+				const MeshRecord & mesh = meshBuffer.mesh(objectMeshes[visibleOrder[i]]);
+				mat4 mvpMatrix = projectionMatrix * viewMatrix * objectModelMatrices[visibleOrder[i]];
+				glUniformMatrix4fv(depthMatrixID, 1, GL_FALSE, &mvpMatrix[0][0]);
+				glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT, (void*)(mesh.firstIndex * sizeof(unsigned short)), mesh.baseVertex);
+			}
+
+			glEndQuery(GL_SAMPLES_PASSED);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+			// Pyramid for next frame's culling
+			if (options.hiz)
+				hiZBuffer.build(offscreenDepthTexture, projectionMatrix * viewMatrix);
+
+			// Depth is final, only test against it
+			glDepthMask(GL_FALSE);
+			glDepthFunc(GL_LEQUAL);
+
+			glUseProgram(programID);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture);
+
+			glBeginQuery(GL_SAMPLES_PASSED, sampleQueries[frameCount % 2][1]);
+		}
+
+		// Accumulate into the transparency targets, every fragment is blended so depth is neither tested nor written
+		if (options.transparency == TRANSPARENCY_OIT)
+		{
+			const GLfloat clearAccumulation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			const GLfloat clearWeight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			glBindFramebuffer(GL_FRAMEBUFFER, oitFramebuffer);
+			glClearBufferfv(GL_COLOR, 0, clearAccumulation);
+			glClearBufferfv(GL_COLOR, 1, clearWeight);
+
+			glDisable(GL_DEPTH_TEST);
+			glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+		}
+
+		auto submitBegin = std::chrono::high_resolution_clock::now();
+
+		if (options.indirect)
+		{
+			// One command per object, in draw order so sorted blending still works
+			indirectDraws.clear();
+			for (unsigned int i = 0; i < visibleOrder.size(); ++i)
+				indirectDraws.add(meshBuffer.mesh(objectMeshes[visibleOrder[i]]), objectModelMatrices[visibleOrder[i]]);
+
+			// Texture unit 4 holds the model matrices, after the cluster data
+			indirectDraws.submit(programID, 4, multiDraw);
+		}
+		else
+		{
+			for (unsigned int i = 0; i < visibleOrder.size(); ++i)
+			{
+				// Apply model matrix to MVP matrix
+				const mat4 & objectModelMatrix = objectModelMatrices[visibleOrder[i]];
+				mat4 mvpMatrix = projectionMatrix * viewMatrix * objectModelMatrix;
+
+				glUniformMatrix4fv(matrixID, 1, GL_FALSE, &mvpMatrix[0][0]);
+				glUniformMatrix4fv(mID, 1, GL_FALSE, &objectModelMatrix[0][0]);
+
+				// Draw the triangles !
+				const MeshRecord & mesh = meshBuffer.mesh(objectMeshes[visibleOrder[i]]);
+				glDrawElementsBaseVertex(
+					GL_TRIANGLES,      // mode
+					mesh.indexCount,    // count
+					GL_UNSIGNED_SHORT,   // type
+					(void*)(mesh.firstIndex * sizeof(unsigned short)),           // element array buffer offset
+					mesh.baseVertex    // added to every index
+				);
+			}
+		}
+
+		auto submitEnd = std::chrono::high_resolution_clock::now();
+		submitMSTotal += std::chrono::duration_cast<std::chrono::microseconds>(submitEnd - submitBegin).count() / 1000.0;
+		drawsTotal += visibleOrder.size();
+
+		// Cull and page in, then draw whatever is resident
+		if (options.meshletPath != NULL)
+		{
+			auto streamBegin = std::chrono::high_resolution_clock::now();
+			meshletStreamer.update(vpMatrix, position, radians(FOV), windowHeight, MESHLET_PAGE_INS_PER_FRAME);
+			auto streamEnd = std::chrono::high_resolution_clock::now();
+			streamMSTotal += std::chrono::duration_cast<std::chrono::microseconds>(streamEnd - streamBegin).count() / 1000.0;
+
+			mat4 identityMatrix = mat4(1.0f);
+			glUniformMatrix4fv(matrixID, 1, GL_FALSE, &vpMatrix[0][0]);
+			glUniformMatrix4fv(mID, 1, GL_FALSE, &identityMatrix[0][0]);
+			meshletStreamer.draw();
+
+			residentMBTotal += meshletStreamer.residentBytes() / (1024.0 * 1024.0);
+			visibleMeshletsTotal += meshletStreamer.visibleCount();
+			frustumCulledTotal += meshletStreamer.frustumCulledCount();
+			coneCulledTotal += meshletStreamer.coneCulledCount();
+			missingMeshletsTotal += meshletStreamer.missingCount();
+			pagedInTotal += meshletStreamer.pagedInCount();
+			evictedTotal += meshletStreamer.evictedCount();
+		}
+
+		if (options.prepass)
+		{
+			glEndQuery(GL_SAMPLES_PASSED);
+			glDepthMask(GL_TRUE);
+			glDepthFunc(GL_LESS);
+		}
+
+		occludedTotal += occludedCount;
 
 		glDisableVertexAttribArray(0);
 		glDisableVertexAttribArray(1);
 		glDisableVertexAttribArray(2);
 
+		// Resolve the transparency targets over the output with a full screen triangle
+		if (options.transparency == TRANSPARENCY_OIT)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			glUseProgram(compositeProgramID);
+
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, oitTextures[0]);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, oitTextures[1]);
+
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+
+			glEnable(GL_DEPTH_TEST);
+		}
+
+		// Swap buffers
+		if (options.bench)
+		{
+			// Wait for the GPU so the frame time covers the rendering, not just the submission
+			glFinish();
+		}
+		else
+		{
+			// Copy the offscreen frame to the window
+			if (offscreen)
+			{
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, offscreenFramebuffer);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+				glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+				glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+			}
+
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+
 		// Get time between this loop and the last one
 		auto end = std::chrono::high_resolution_clock::now();
 		auto duration = end - begin;
@@ -297,79 +768,129 @@ int main( void )
 		auto durationInMS = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
 		auto durationInS = durationInMS / 1000000.0f;
 
-		printf("%f ms per frame\n", durationInMS / 1000.0f);
-		
-		deltaTime = durationInS;
+		if (options.bench)
+		{
+			// Animation always advances by the fixed step so every run renders the same frames
+			benchStats.addFrame(durationInMS / 1000.0);
+			simulationTime += options.benchTimeStep;
+		}
+		else
+		{
+			printf("%f ms per frame, %f ms light binning, %f lights per cluster\n", durationInMS / 1000.0f,
+				lightClusters.binningMS(), lightClusters.averageLightsPerCluster());
+
+			if (options.prepass)
+				printf("%u objects occluded, %u of %u samples shaded\n", occludedCount, lastShadedSamples, lastPrepassSamples);
+
+			if (options.meshletPath != NULL)
+				printf("%u meshlets visible, %u frustum culled, %u cone culled, %u missing, %u paged in, %u evicted, %.1f of %.1f MB resident\n",
+					meshletStreamer.visibleCount(), meshletStreamer.frustumCulledCount(), meshletStreamer.coneCulledCount(), meshletStreamer.missingCount(),
+					meshletStreamer.pagedInCount(), meshletStreamer.evictedCount(), meshletStreamer.residentBytes() / (1024.0 * 1024.0), meshletStreamer.budgetBytes() / (1024.0 * 1024.0));
+
+			if (options.objectCount > 1)
+				printf("%f ms submit, %f ms per 10k draws\n", std::chrono::duration_cast<std::chrono::microseconds>(submitEnd - submitBegin).count() / 1000.0,
+					visibleOrder.empty() ? 0.0 : std::chrono::duration_cast<std::chrono::microseconds>(submitEnd - submitBegin).count() / 100.0 / visibleOrder.size());
+
+			deltaTime = durationInS;
+			simulationTime += durationInS;
+		}
 
 		// Update last time counted
 		begin = end;
 
-		// Swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		++frameCount;
 
-	} // Check if the ESC key was pressed or the window was closed
-	while( glfwGetKey(window, GLFW_KEY_ESCAPE ) != GLFW_PRESS &&
+	} // Check if the ESC key was pressed or the window was closed, or the benchmark is done
+	while( options.bench ? frameCount < options.benchFrames :
+		   glfwGetKey(window, GLFW_KEY_ESCAPE ) != GLFW_PRESS &&
 		   glfwWindowShouldClose(window) == 0 );
 
-	// Close OpenGL window and terminate GLFW
-	glfwTerminate();
-
-	return 0;
-}
-
-// Ghetto function, made just because I can
-// This will be replaced by a library function later
-GLuint loadBMP_custom(const char * imagepath)
-{
-	// Data read from BMP file header
-	unsigned char header[54];	// BMP files start with a 54 byte header
-	unsigned int dataPos;		// Position in the file where the actual data begins
-	unsigned int width, height;
-	unsigned int imageSize;		// = width*height*3 because one for each RGB
-	unsigned char *data;		// Actual RGB data
-
-	FILE *file = fopen(imagepath, "rb");
-
-	// Validate file opening
-	if (!file)
+	if (options.bench)
 	{
-		printf("Image could not be opened! \n");
-		return 0;
+		benchStats.setCounter("objectCount", (double)objectPositions.size());
+		if (options.transparency == TRANSPARENCY_SORTED)
+			benchStats.setCounter("sortMS", sortMSTotal / frameCount);
+
+		if (options.prepass)
+		{
+			// Query results lag a frame, the last frame's are never read
+			int measuredFrames = std::max(1, frameCount - 1);
+			benchStats.setCounter("occludedObjects", occludedTotal / frameCount);
+			benchStats.setCounter("prepassSamples", prepassSamplesTotal / measuredFrames);
+			benchStats.setCounter("shadedSamples", shadedSamplesTotal / measuredFrames);
+			benchStats.setCounter("shadingSavedPercent", prepassSamplesTotal > 0.0 ? 100.0 * (1.0 - shadedSamplesTotal / prepassSamplesTotal) : 0.0);
+		}
+
+		benchStats.setCounter("loadMS", loadMS);
+		benchStats.setCounter("loadHeapAllocations", (double)loadAllocations);
+		benchStats.setCounter("loadHeapBytes", (double)loadAllocationBytes);
+		benchStats.setCounter("textureLoadMS", textureLoadMS);
+
+		benchStats.setCounter("submitMS", submitMSTotal / frameCount);
+		benchStats.setCounter("submitMSPer10kDraws", drawsTotal > 0.0 ? submitMSTotal / drawsTotal * 10000.0 : 0.0);
+
+		if (options.meshletPath != NULL)
+		{
+			benchStats.setCounter("meshletCount", meshletStreamer.meshletCount());
+			benchStats.setCounter("meshletStreamMS", streamMSTotal / frameCount);
+			benchStats.setCounter("meshletResidentMB", residentMBTotal / frameCount);
+			benchStats.setCounter("meshletBudgetMB", meshletStreamer.budgetBytes() / (1024.0 * 1024.0));
+			benchStats.setCounter("meshletsVisible", visibleMeshletsTotal / frameCount);
+			benchStats.setCounter("meshletsFrustumCulled", frustumCulledTotal / frameCount);
+			benchStats.setCounter("meshletsConeCulled", coneCulledTotal / frameCount);
+			benchStats.setCounter("meshletsMissing", missingMeshletsTotal / frameCount);
+			benchStats.setCounter("meshletsPagedIn", pagedInTotal / frameCount);
+			benchStats.setCounter("meshletsEvicted", evictedTotal / frameCount);
+		}
+
+		benchStats.setCounter("lightCount", (double)lights.size());
+		benchStats.setCounter("lightBinningMS", binningMSTotal / frameCount);
+		benchStats.setCounter("lightsPerCluster", lightsPerClusterTotal / frameCount);
+
+		benchStats.printSummary();
+		const char * transparencyNames[4] = { "opaque", "blend", "sorted", "oit" };
+		char sceneName[128];
+		snprintf(sceneName, sizeof(sceneName), "%d objects, %s%s%s%s", options.objectCount, transparencyNames[options.transparency],
+			options.hiz ? ", prepass + hiz" : options.prepass ? ", prepass" : "",
+			!options.indirect ? "" : multiDraw ? ", multi draw indirect" : ", indirect loop",
+			options.meshletPath != NULL ? ", streamed meshlets" : "");
+
+		benchStats.writeJSON(options.benchOutput, sceneName, options.benchTimeStep);
+
 	}
 
-	// Validate header against BMP format
-	if (fread(header, 1, 54, file) != 54)
+	glDeleteQueries(4, &sampleQueries[0][0]);
+
+	if (offscreen)
 	{
-		printf("Header for this BMP file is not correct, or it is not a BMP \n");
-		return 0;
+		glDeleteFramebuffers(1, &offscreenFramebuffer);
+		glDeleteRenderbuffers(1, &offscreenColorBuffer);
+		glDeleteTextures(1, &offscreenDepthTexture);
 	}
 
-	// The first two bytes of a BMP are "BM"
-	if (header[0] != 'B' || header[1] != 'M')
+	if (oitFramebuffer != 0)
 	{
-		printf("Byte check for this BMP file is not correct, or it is not a BMP \n");
-		return 0;
+		glDeleteFramebuffers(1, &oitFramebuffer);
+		glDeleteTextures(2, oitTextures);
 	}
 
-	// Read ints from the byte array
-	dataPos		= *(int*)&(header[0x0A]);
-	imageSize	= *(int*)&(header[0x22]);
-	width		= *(int*)&(header[0x12]);
-	height		= *(int*)&(header[0x16]);
-
-	// Some BMP files are misformatted, guess missing information
-	if (imageSize == 0)    imageSize = width * height * 3;
-	if (dataPos == 0)      dataPos = 54;	// Bypass the 54 byte header
+	// Close OpenGL window and terminate GLFW
+	glfwTerminate();
 
-	// Create a new buffer for the data
-	data = new unsigned char[imageSize];
+	return 0;
+}
 
-	// Read the data from the file into the buffer
-	fread(data, 1, imageSize, file);
+// Ghetto function, made just because I can
+// This will be replaced by a library function later
+GLuint loadBMP_custom(const char * imagepath)
+{
+	// Staging memory is reused from one texture to the next
+	static ImageDecoder decoder;
 
-	// Close the file, we are done with it
-	fclose(file);
+	// The meshes' V is flipped for DDS textures, so rows go top to bottom like a DDS
+	const Image * image = decoder.decode(imagepath, true);
+	if (image == NULL)
+		return 0;
 
 	// ID for textures
 	GLuint textureID;
@@ -379,8 +900,8 @@ GLuint loadBMP_custom(const char * imagepath)
 	// Bind the texture
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
-	// Pass the image into OpenGL
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
+	// Pass the image into OpenGL, RGBA rows are always 4 byte aligned and need no conversion by the driver
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image->width, image->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image->pixels.data());
 
 	// When MAGnifying the image (no bigger mipmap available), use LINEAR filtering
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -391,7 +912,7 @@ GLuint loadBMP_custom(const char * imagepath)
 	// Generate mipmaps, by the way.
 	glGenerateMipmap(GL_TEXTURE_2D);
 
-	return 1;
+	return textureID;
 }
 
 #define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
@@ -553,7 +1074,20 @@ void computeMatriciesFromInputs()
 		position -= up * deltaTime * MOVE_SPEED;
 	}
 
-	projectionMatrix = perspective(radians(FOV), 4.0f / 3.0f, 0.1f, 100.0f);
+	projectionMatrix = perspective(radians(FOV), ASPECT_RATIO, Z_NEAR, Z_FAR);
+	viewMatrix = lookAt(position, position + forward, up);
+}
+
+// Same camera model as computeMatriciesFromInputs, but the pose comes from the path instead of the mouse and keyboard
+void computeMatriciesFromPath(const CameraPath & path, float t)
+{
+	path.sample(t, position, horizontalAngle, verticalAngle);
+
+	vec3 forward(cos(verticalAngle) * sin(horizontalAngle), sin(verticalAngle), cos(verticalAngle) * cos(horizontalAngle));
+	vec3 right(sin(horizontalAngle - M_PI_2), 0, cos(horizontalAngle - M_PI_2));
+	vec3 up = cross(right, forward);
+
+	projectionMatrix = perspective(radians(FOV), ASPECT_RATIO, Z_NEAR, Z_FAR);
 	viewMatrix = lookAt(position, position + forward, up);
 }
 
@@ -572,3 +1106,202 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 	FOV -= 5 * yoffset;
 }
 
+void generateLights(int count, std::vector<PointLight> & out_lights)
+{
+	PointLight mainLight;
+	mainLight.position =	LIGHT_POSITION;
+	mainLight.color =		LIGHT_COLOR;
+	mainLight.intensity =	LIGHT_INTENSITY;
+	mainLight.radius =		lightRadius(LIGHT_INTENSITY);
+	out_lights.push_back(mainLight);
+
+	// Fixed seed so every run, and every benchmark, gets the same lights
+	std::mt19937 generator(1234);
+
+	// Spread the lights out more as there are more of them, keeping the density around the model sane
+	float extent = std::max(10.0f, 2.0f * (float)cbrt((double)count));
+	std::uniform_real_distribution<float> positionDistribution(-extent, extent);
+	std::uniform_real_distribution<float> colorDistribution(0.2f, 1.0f);
+	std::uniform_real_distribution<float> intensityDistribution(0.5f, 3.0f);
+
+	for (int i = 0; i < count; ++i)
+	{
+		PointLight light;
+		light.position =	vec3(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator));
+		light.color =		vec3(colorDistribution(generator), colorDistribution(generator), colorDistribution(generator));
+		light.intensity =	intensityDistribution(generator);
+		light.radius =		lightRadius(light.intensity);
+		out_lights.push_back(light);
+	}
+}
+
+bool parseOptions(int argc, char * argv[], Options & options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		// Options that take a value
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--bench") == 0)
+		{
+			options.bench = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+		{
+			options.benchFrames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--dt") == 0 && hasValue)
+		{
+			options.benchTimeStep = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--path") == 0 && hasValue)
+		{
+			options.benchPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--out") == 0 && hasValue)
+		{
+			options.benchOutput = argv[++i];
+		}
+		else if (strcmp(argv[i], "--record") == 0 && hasValue)
+		{
+			options.recordPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--lights") == 0 && hasValue)
+		{
+			options.lightCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--objects") == 0 && hasValue)
+		{
+			options.objectCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--transparency") == 0 && hasValue)
+		{
+			++i;
+			if (strcmp(argv[i], "opaque") == 0)
+				options.transparency = TRANSPARENCY_OPAQUE;
+			else if (strcmp(argv[i], "blend") == 0)
+				options.transparency = TRANSPARENCY_BLEND;
+			else if (strcmp(argv[i], "sorted") == 0)
+				options.transparency = TRANSPARENCY_SORTED;
+			else if (strcmp(argv[i], "oit") == 0)
+				options.transparency = TRANSPARENCY_OIT;
+			else
+			{
+				printf("Unknown transparency mode %s, expected opaque, blend, sorted or oit\n", argv[i]);
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--oit-reference") == 0)
+		{
+			options.oitReference = true;
+		}
+		else if (strcmp(argv[i], "--prepass") == 0)
+		{
+			options.prepass = true;
+		}
+		else if (strcmp(argv[i], "--indirect") == 0)
+		{
+			options.indirect = true;
+		}
+		else if (strcmp(argv[i], "--meshlets") == 0 && i + 1 < argc)
+		{
+			options.meshletPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--meshlet-budget") == 0 && i + 1 < argc)
+		{
+			options.meshletBudgetMB = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+		{
+			options.texturePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--no-arena") == 0)
+		{
+			options.arena = false;
+		}
+		else if (strcmp(argv[i], "--indirect-loop") == 0)
+		{
+			options.indirect = true;
+			options.indirectLoop = true;
+		}
+		else if (strcmp(argv[i], "--hiz") == 0)
+		{
+			// The pyramid is built from the prepass depth
+			options.prepass = true;
+			options.hiz = true;
+		}
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			printf("Usage: playground [--bench] [--frames N] [--dt seconds] [--path camera.txt] [--out results.json] [--record camera.txt] [--lights N]\n");
+			printf("                  [--objects N] [--transparency opaque|blend|sorted|oit] [--oit-reference] [--prepass] [--hiz]\n");
+			printf("                  [--indirect] [--indirect-loop] [--no-arena] [--meshlets mesh.mltc] [--meshlet-budget MB]\n");
+			printf("                  [--texture image.bmp|image.tga]\n");
+			return false;
+		}
+	}
+
+	// A streamed mesh can be the whole scene
+	if (options.objectCount < 0 || (options.objectCount == 0 && options.meshletPath == NULL))
+	{
+		printf("Object count must be positive\n");
+		return false;
+	}
+
+	// The streamed mesh is drawn with the basic program and is not part of the prepass
+	if (options.meshletPath != NULL && (options.prepass || options.indirect))
+	{
+		printf("--meshlets can not be combined with --prepass, --hiz or --indirect\n");
+		return false;
+	}
+
+	if (options.meshletBudgetMB <= 0)
+	{
+		printf("Meshlet budget must be positive\n");
+		return false;
+	}
+
+	// Transparent objects do not occlude, a prepass would hide what is behind them
+	if (options.prepass && options.transparency != TRANSPARENCY_OPAQUE)
+	{
+		printf("--prepass and --hiz need --transparency opaque\n");
+		return false;
+	}
+
+	// The depth only shader takes its matrix from a uniform, not from the indirect draw data
+	if (options.prepass && options.indirect)
+	{
+		printf("--indirect can not be combined with --prepass or --hiz\n");
+		return false;
+	}
+
+	if (options.lightCount < 0)
+	{
+		printf("Light count can not be negative\n");
+		return false;
+	}
+
+	if (options.benchFrames <= 0 || options.benchTimeStep <= 0.0f)
+	{
+		printf("Benchmark frame count and time step must be positive\n");
+		return false;
+	}
+
+	return true;
+}
+
+void generateObjectPositions(int count, std::vector<vec3> & out_positions)
+{
+	// Smallest cube of objects that fits the count, filled layer by layer
+	const float SPACING = 2.5f;
+	int side = (int)ceil(cbrt((double)count));
+	float offset = (side - 1) * SPACING * 0.5f;
+
+	for (int i = 0; i < count; ++i)
+	{
+		int x = i % side;
+		int y = (i / side) % side;
+		int z = i / (side * side);
+		out_positions.push_back(vec3(x * SPACING - offset, y * SPACING - offset, z * SPACING - offset));
+	}
+}
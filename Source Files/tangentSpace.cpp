@@ -0,0 +1,171 @@
+#include "tangentSpace.hpp"
+
+#include <algorithm>	// For max, min
+#include <thread>
+
+// SSE is always there on x64, and on x86 when the compiler is allowed to use it
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TANGENT_SPACE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Triangles are handed to threads in groups of this many, so which triangles take the SSE path
+// does not depend on the thread count
+const unsigned int TRIANGLE_GROUP = 4;
+
+#ifdef TANGENT_SPACE_SSE
+
+// One component of 4 consecutive triangles, stride is the floats per triangle
+static inline __m128 gather(const float * base, unsigned int stride, unsigned int offset)
+{
+	return _mm_setr_ps(base[offset], base[stride + offset], base[stride * 2 + offset], base[stride * 3 + offset]);
+}
+
+#endif
+
+// Triangles [first, last), 4 at a time with SSE, the rest one at a time
+static void computeTriangleRange(
+	const vec3 * vertices,
+	const vec2 * uvs,
+	vec3 * tangents,
+	vec3 * bitangents,
+	unsigned int first,
+	unsigned int last
+){
+	unsigned int t = first;
+
+#ifdef TANGENT_SPACE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (; t + 4 <= last; t += 4)
+	{
+		// The vertices are arrays of structures, so each component is gathered into its own register
+		const float * p = (const float *)&vertices[t * 3];	// 9 floats per triangle
+		const float * u = (const float *)&uvs[t * 3];		// 6 floats per triangle
+
+		__m128 deltaPos1x = _mm_sub_ps(gather(p, 9, 3), gather(p, 9, 0));
+		__m128 deltaPos1y = _mm_sub_ps(gather(p, 9, 4), gather(p, 9, 1));
+		__m128 deltaPos1z = _mm_sub_ps(gather(p, 9, 5), gather(p, 9, 2));
+		__m128 deltaPos2x = _mm_sub_ps(gather(p, 9, 6), gather(p, 9, 0));
+		__m128 deltaPos2y = _mm_sub_ps(gather(p, 9, 7), gather(p, 9, 1));
+		__m128 deltaPos2z = _mm_sub_ps(gather(p, 9, 8), gather(p, 9, 2));
+
+		__m128 deltaUV1x = _mm_sub_ps(gather(u, 6, 2), gather(u, 6, 0));
+		__m128 deltaUV1y = _mm_sub_ps(gather(u, 6, 3), gather(u, 6, 1));
+		__m128 deltaUV2x = _mm_sub_ps(gather(u, 6, 4), gather(u, 6, 0));
+		__m128 deltaUV2y = _mm_sub_ps(gather(u, 6, 5), gather(u, 6, 1));
+
+		// Lanes with degenerate UVs are masked to 0, like the scalar version
+		__m128 determinant = _mm_sub_ps(_mm_mul_ps(deltaUV1x, deltaUV2y), _mm_mul_ps(deltaUV1y, deltaUV2x));
+		__m128 r = _mm_and_ps(_mm_div_ps(one, determinant), _mm_cmpneq_ps(determinant, zero));
+
+		float tangent[3][4];
+		float bitangent[3][4];
+		_mm_storeu_ps(tangent[0], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(deltaPos1x, deltaUV2y), _mm_mul_ps(deltaPos2x, deltaUV1y)), r));
+		_mm_storeu_ps(tangent[1], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(deltaPos1y, deltaUV2y), _mm_mul_ps(deltaPos2y, deltaUV1y)), r));
+		_mm_storeu_ps(tangent[2], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(deltaPos1z, deltaUV2y), _mm_mul_ps(deltaPos2z, deltaUV1y)), r));
+		_mm_storeu_ps(bitangent[0], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(deltaPos2x, deltaUV1x), _mm_mul_ps(deltaPos1x, deltaUV2x)), r));
+		_mm_storeu_ps(bitangent[1], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(deltaPos2y, deltaUV1x), _mm_mul_ps(deltaPos1y, deltaUV2x)), r));
+		_mm_storeu_ps(bitangent[2], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(deltaPos2z, deltaUV1x), _mm_mul_ps(deltaPos1z, deltaUV2x)), r));
+
+		for (unsigned int lane = 0; lane < 4; ++lane)
+		{
+			unsigned int i = (t + lane) * 3;
+			vec3 laneTangent(tangent[0][lane], tangent[1][lane], tangent[2][lane]);
+			vec3 laneBitangent(bitangent[0][lane], bitangent[1][lane], bitangent[2][lane]);
+
+			tangents[i] = tangents[i + 1] = tangents[i + 2] = laneTangent;
+			bitangents[i] = bitangents[i + 1] = bitangents[i + 2] = laneBitangent;
+		}
+	}
+#endif
+
+	for (; t < last; ++t)
+	{
+		unsigned int i = t * 3;
+
+		// Edges of the triangle in model space and in UV space
+		vec3 deltaPos1 = vertices[i + 1] - vertices[i];
+		vec3 deltaPos2 = vertices[i + 2] - vertices[i];
+		vec2 deltaUV1 = uvs[i + 1] - uvs[i];
+		vec2 deltaUV2 = uvs[i + 2] - uvs[i];
+
+		// Degenerate UVs give a zero basis rather than infinities, orthogonalizing later picks any tangent for them
+		float determinant = deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x;
+		float r = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+		vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
+		vec3 bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * r;
+
+		tangents[i] = tangents[i + 1] = tangents[i + 2] = tangent;
+		bitangents[i] = bitangents[i + 1] = bitangents[i + 2] = bitangent;
+	}
+}
+
+unsigned int computeTangentBasis(
+	const std::vector<vec3> & vertices,
+	const std::vector<vec2> & uvs,
+	std::vector<vec3> & out_tangents,
+	std::vector<vec3> & out_bitangents,
+	unsigned int threadCount,
+	unsigned int minTrianglesPerThread
+){
+	unsigned int triangleCount = (unsigned int)vertices.size() / 3;
+
+	out_tangents.resize(vertices.size());
+	out_bitangents.resize(vertices.size());
+
+	if (triangleCount == 0)
+		return 0;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	unsigned int groupCount = (triangleCount + TRIANGLE_GROUP - 1) / TRIANGLE_GROUP;
+	threadCount = std::max(1u, std::min(std::min(threadCount, groupCount), triangleCount / std::max(1u, minTrianglesPerThread)));
+
+	// Contiguous ranges of whole groups, each thread writes only its own triangles' corners
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < threadCount; ++t)
+	{
+		unsigned int first = (unsigned int)((unsigned long long)groupCount * t / threadCount) * TRIANGLE_GROUP;
+		unsigned int last = std::min(triangleCount, (unsigned int)((unsigned long long)groupCount * (t + 1) / threadCount) * TRIANGLE_GROUP);
+
+		if (t + 1 == threadCount)
+			computeTriangleRange(vertices.data(), uvs.data(), out_tangents.data(), out_bitangents.data(), first, last);
+		else
+			threads.push_back(std::thread(computeTriangleRange, vertices.data(), uvs.data(), out_tangents.data(), out_bitangents.data(), first, last));
+	}
+
+	for (unsigned int t = 0; t < threads.size(); ++t)
+		threads[t].join();
+
+	return threadCount;
+}
+
+void orthogonalizeTangentBasis(
+	const std::vector<vec3> & normals,
+	std::vector<vec3> & tangents,
+	std::vector<vec3> & bitangents,
+	unsigned int first
+){
+	for (unsigned int i = first; i < tangents.size(); ++i)
+	{
+		const vec3 & n = normals[i];
+
+		// Remove the part along the normal
+		vec3 t = tangents[i] - n * dot(n, tangents[i]);
+
+		// Tangent parallel to the normal, or none at all, any direction in the plane will do
+		if (dot(t, t) < 1e-12f)
+			t = std::abs(n.x) < 0.9f ? cross(n, vec3(1.0f, 0.0f, 0.0f)) : cross(n, vec3(0.0f, 1.0f, 0.0f));
+
+		t = normalize(t);
+
+		// Mirrored UVs flip the bitangent
+		float handedness = dot(cross(n, t), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+
+		tangents[i] = t;
+		bitangents[i] = cross(n, t) * handedness;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace glm;
+
+// Below this many triangles per thread, starting threads costs more than it saves
+const unsigned int MIN_TRIANGLES_PER_THREAD = 16384;
+
+// Per triangle tangent and bitangent for loadOBJ's output, where every 3 vertices are a triangle
+// All 3 corners of a triangle get the triangle's basis, feed the result to indexVBO_TBN to average it over shared vertices.
+// Triangles are split over threadCount threads, 0 uses every hardware thread, but no thread gets fewer than
+// minTrianglesPerThread. Returns the number of threads used. Each triangle is computed on its own,
+// so the result is the same for any thread count.
+unsigned int computeTangentBasis(
+	const std::vector<vec3> & vertices,
+	const std::vector<vec2> & uvs,
+	std::vector<vec3> & out_tangents,
+	std::vector<vec3> & out_bitangents,
+	unsigned int threadCount = 0,
+	unsigned int minTrianglesPerThread = MIN_TRIANGLES_PER_THREAD
+);
+
+// Gram-Schmidt orthogonalizes each tangent against its normal and rebuilds the bitangent as cross(normal, tangent),
+// negated where the UV mapping is mirrored so the handedness of the original bitangent is kept.
+// Vertices before first are left alone.
+void orthogonalizeTangentBasis(
+	const std::vector<vec3> & normals,
+	std::vector<vec3> & tangents,
+	std::vector<vec3> & bitangents,
+	unsigned int first = 0
+);
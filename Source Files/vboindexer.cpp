@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 
 #include "vboindexer.hpp"
+#include "tangentSpace.hpp"
 
 #include <string.h> // for memcmp
 
@@ -83,12 +84,15 @@ struct PackedVertex{
 	};
 };
 
+typedef ArenaAllocator< std::pair<const PackedVertex,unsigned int> > VertexMapAllocator;
+typedef std::map<PackedVertex,unsigned int,std::less<PackedVertex>,VertexMapAllocator> VertexMap;
+
 bool getSimilarVertexIndex_fast( 
 	PackedVertex & packed, 
-	std::map<PackedVertex,unsigned short> & VertexToOutIndex,
-	unsigned short & result
+	VertexMap & VertexToOutIndex,
+	unsigned int & result
 ){
-	std::map<PackedVertex,unsigned short>::iterator it = VertexToOutIndex.find(packed);
+	VertexMap::iterator it = VertexToOutIndex.find(packed);
 	if ( it == VertexToOutIndex.end() ){
 		return false;
 	}else{
@@ -97,17 +101,24 @@ bool getSimilarVertexIndex_fast(
 	}
 }
 
-void indexVBO(
+// Shared by the 16 and 32 bit index versions
+template <typename IndexType>
+static void indexVBO_impl(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
 	std::vector<glm::vec3> & in_normals,
 
-	std::vector<unsigned short> & out_indices,
+	std::vector<IndexType> & out_indices,
 	std::vector<glm::vec3> & out_vertices,
 	std::vector<glm::vec2> & out_uvs,
-	std::vector<glm::vec3> & out_normals
+	std::vector<glm::vec3> & out_normals,
+
+	Arena * arena
 ){
-	std::map<PackedVertex,unsigned short> VertexToOutIndex;
+	// One tree node per unique vertex, taken from the arena when there is one
+	VertexMap VertexToOutIndex( (VertexMapAllocator(arena)) );
+
+	out_indices.reserve( out_indices.size() + in_vertices.size() );
 
 	// For each input vertex
 	for ( unsigned int i=0; i<in_vertices.size(); i++ ){
@@ -116,53 +127,96 @@ void indexVBO(
 		
 
 		// Try to find a similar vertex in out_XXXX
-		unsigned short index;
+		unsigned int index;
 		bool found = getSimilarVertexIndex_fast( packed, VertexToOutIndex, index);
 
 		if ( found ){ // A similar vertex is already in the VBO, use it instead !
-			out_indices.push_back( index );
+			out_indices.push_back( (IndexType)index );
 		}else{ // If not, it needs to be added in the output data.
 			out_vertices.push_back( in_vertices[i]);
 			out_uvs     .push_back( in_uvs[i]);
 			out_normals .push_back( in_normals[i]);
-			unsigned short newindex = (unsigned short)out_vertices.size() - 1;
-			out_indices .push_back( newindex );
+			unsigned int newindex = (unsigned int)out_vertices.size() - 1;
+			out_indices .push_back( (IndexType)newindex );
 			VertexToOutIndex[ packed ] = newindex;
 		}
 	}
 }
 
+void indexVBO(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
 
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
 
+	Arena * arena
+){
+	indexVBO_impl(in_vertices, in_uvs, in_normals, out_indices, out_vertices, out_uvs, out_normals, arena);
+}
 
+void indexVBO(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
 
+	Arena * arena
+){
+	indexVBO_impl(in_vertices, in_uvs, in_normals, out_indices, out_vertices, out_uvs, out_normals, arena);
+}
 
 
-void indexVBO_TBN(
+
+
+
+
+
+// Shared by the 16 and 32 bit index versions
+template <typename IndexType>
+static void indexVBO_TBN_impl(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
 	std::vector<glm::vec3> & in_normals,
 	std::vector<glm::vec3> & in_tangents,
 	std::vector<glm::vec3> & in_bitangents,
 
-	std::vector<unsigned short> & out_indices,
+	std::vector<IndexType> & out_indices,
 	std::vector<glm::vec3> & out_vertices,
 	std::vector<glm::vec2> & out_uvs,
 	std::vector<glm::vec3> & out_normals,
 	std::vector<glm::vec3> & out_tangents,
-	std::vector<glm::vec3> & out_bitangents
+	std::vector<glm::vec3> & out_bitangents,
+
+	Arena * arena
 ){
+	VertexMap VertexToOutIndex( (VertexMapAllocator(arena)) );
+
+	// Only the new vertices' bases are orthogonalized at the end
+	unsigned int firstVertex = (unsigned int)out_vertices.size();
+
+	out_indices.reserve( out_indices.size() + in_vertices.size() );
+
 	// For each input vertex
 	for ( unsigned int i=0; i<in_vertices.size(); i++ ){
 
+		PackedVertex packed = {in_vertices[i], in_uvs[i], in_normals[i]};
+
 		// Try to find a similar vertex in out_XXXX
-		unsigned short index;
-		bool found = getSimilarVertexIndex(in_vertices[i], in_uvs[i], in_normals[i],     out_vertices, out_uvs, out_normals, index);
+		unsigned int index;
+		bool found = getSimilarVertexIndex_fast( packed, VertexToOutIndex, index);
 
 		if ( found ){ // A similar vertex is already in the VBO, use it instead !
-			out_indices.push_back( index );
+			out_indices.push_back( (IndexType)index );
 
-			// Average the tangents and the bitangents
+			// Average the tangents and the bitangents, always summed in input order so the result is reproducible
 			out_tangents[index] += in_tangents[i];
 			out_bitangents[index] += in_bitangents[i];
 		}else{ // If not, it needs to be added in the output data.
@@ -171,7 +225,50 @@ void indexVBO_TBN(
 			out_normals .push_back( in_normals[i]);
 			out_tangents .push_back( in_tangents[i]);
 			out_bitangents .push_back( in_bitangents[i]);
-			out_indices .push_back( (unsigned short)out_vertices.size() - 1 );
+			unsigned int newindex = (unsigned int)out_vertices.size() - 1;
+			out_indices .push_back( (IndexType)newindex );
+			VertexToOutIndex[ packed ] = newindex;
 		}
 	}
+
+	// The sums are not unit length or perpendicular to the normal any more
+	orthogonalizeTangentBasis(out_normals, out_tangents, out_bitangents, firstVertex);
+}
+
+void indexVBO_TBN(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents,
+
+	Arena * arena
+){
+	indexVBO_TBN_impl(in_vertices, in_uvs, in_normals, in_tangents, in_bitangents, out_indices, out_vertices, out_uvs, out_normals, out_tangents, out_bitangents, arena);
+}
+
+void indexVBO_TBN(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents,
+
+	Arena * arena
+){
+	indexVBO_TBN_impl(in_vertices, in_uvs, in_normals, in_tangents, in_bitangents, out_indices, out_vertices, out_uvs, out_normals, out_tangents, out_bitangents, arena);
 }
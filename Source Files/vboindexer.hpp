@@ -1,6 +1,8 @@
 #ifndef VBOINDEXER_HPP
 #define VBOINDEXER_HPP
 
+#include "arena.hpp"
+
 void indexVBO(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
@@ -9,10 +11,27 @@ void indexVBO(
 	std::vector<unsigned short> & out_indices,
 	std::vector<glm::vec3> & out_vertices,
 	std::vector<glm::vec2> & out_uvs,
-	std::vector<glm::vec3> & out_normals
+	std::vector<glm::vec3> & out_normals,
+
+	Arena * arena = NULL	// For the vertex lookup, heap if NULL
 );
 
+// Same with 32 bit indices, for meshes with more than 65536 unique vertices
+void indexVBO(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
 
+	Arena * arena = NULL
+);
+
+// Tangents and bitangents from computeTangentBasis are summed over each shared vertex, then orthogonalized
+// against its normal with the handedness kept
 void indexVBO_TBN(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
@@ -25,7 +44,27 @@ void indexVBO_TBN(
 	std::vector<glm::vec2> & out_uvs,
 	std::vector<glm::vec3> & out_normals,
 	std::vector<glm::vec3> & out_tangents,
-	std::vector<glm::vec3> & out_bitangents
+	std::vector<glm::vec3> & out_bitangents,
+
+	Arena * arena = NULL
+);
+
+// Same with 32 bit indices
+void indexVBO_TBN(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents,
+
+	Arena * arena = NULL
 );
 
 #endif
\ No newline at end of file